@@ -69,6 +69,9 @@
 
 #define SO_RXQ_OVFL             40
 
+/* Private option, kept well away from the numbers upstream hands out */
+#define SO_RCVDEFER             0x5244
+
 /* O_NONBLOCK clashes with the bits used for socket types.  Therefore we
  * have to define SOCK_NONBLOCK to a different value here.
  */
@@ -0,0 +1,435 @@
+/*
+ * Glue Code for the asm optimized version of the AES Cipher Algorithm
+ *
+ * Besides the bare cipher, ECB, CBC, CTR and XTS are registered as
+ * blkciphers that call the assembler block functions directly, instead of
+ * going through the generic templates and an indirect call per block.
+ */
+
+#include <linux/module.h>
+#include <linux/crypto.h>
+#include <crypto/aes.h>
+#include <crypto/algapi.h>
+
+asmlinkage void aes_arm_enc_blk(struct crypto_aes_ctx *ctx, u8 *out,
+				const u8 *in);
+asmlinkage void aes_arm_dec_blk(struct crypto_aes_ctx *ctx, u8 *out,
+				const u8 *in);
+
+static void aes_encrypt(struct crypto_tfm *tfm, u8 *dst, const u8 *src)
+{
+	aes_arm_enc_blk(crypto_tfm_ctx(tfm), dst, src);
+}
+
+static void aes_decrypt(struct crypto_tfm *tfm, u8 *dst, const u8 *src)
+{
+	aes_arm_dec_blk(crypto_tfm_ctx(tfm), dst, src);
+}
+
+static struct crypto_alg aes_alg = {
+	.cra_name		= "aes",
+	.cra_driver_name	= "aes-asm",
+	.cra_priority		= 200,
+	.cra_flags		= CRYPTO_ALG_TYPE_CIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct crypto_aes_ctx),
+	.cra_alignmask		= 3,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aes_alg.cra_list),
+	.cra_u	= {
+		.cipher	= {
+			.cia_min_keysize	= AES_MIN_KEY_SIZE,
+			.cia_max_keysize	= AES_MAX_KEY_SIZE,
+			.cia_setkey		= crypto_aes_set_key,
+			.cia_encrypt		= aes_encrypt,
+			.cia_decrypt		= aes_decrypt
+		}
+	}
+};
+
+static int aes_setkey(struct crypto_tfm *tfm, const u8 *key,
+		      unsigned int keylen)
+{
+	return crypto_aes_set_key(tfm, key, keylen);
+}
+
+static int ecb_encrypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	struct crypto_aes_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		do {
+			aes_arm_enc_blk(ctx, d, s);
+			s += AES_BLOCK_SIZE;
+			d += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int ecb_decrypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	struct crypto_aes_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		do {
+			aes_arm_dec_blk(ctx, d, s);
+			s += AES_BLOCK_SIZE;
+			d += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int cbc_encrypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	struct crypto_aes_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		do {
+			crypto_xor(walk.iv, s, AES_BLOCK_SIZE);
+			aes_arm_enc_blk(ctx, d, walk.iv);
+			memcpy(walk.iv, d, AES_BLOCK_SIZE);
+			s += AES_BLOCK_SIZE;
+			d += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int cbc_decrypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	struct crypto_aes_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u32 buf[AES_BLOCK_SIZE / sizeof(u32)];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		/* keep the ciphertext block, d may be s */
+		do {
+			memcpy(buf, s, AES_BLOCK_SIZE);
+			aes_arm_dec_blk(ctx, d, s);
+			crypto_xor(d, walk.iv, AES_BLOCK_SIZE);
+			memcpy(walk.iv, buf, AES_BLOCK_SIZE);
+			s += AES_BLOCK_SIZE;
+			d += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int ctr_crypt(struct blkcipher_desc *desc,
+		     struct scatterlist *dst, struct scatterlist *src,
+		     unsigned int nbytes)
+{
+	struct crypto_aes_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u32 ks[AES_BLOCK_SIZE / sizeof(u32)];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
+
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		do {
+			aes_arm_enc_blk(ctx, (u8 *)ks, walk.iv);
+			crypto_inc(walk.iv, AES_BLOCK_SIZE);
+			if (d != s)
+				memcpy(d, s, AES_BLOCK_SIZE);
+			crypto_xor(d, (u8 *)ks, AES_BLOCK_SIZE);
+			s += AES_BLOCK_SIZE;
+			d += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	/* final partial block */
+	if (walk.nbytes) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		aes_arm_enc_blk(ctx, (u8 *)ks, walk.iv);
+		crypto_inc(walk.iv, AES_BLOCK_SIZE);
+		if (d != s)
+			memcpy(d, s, nbytes);
+		crypto_xor(d, (u8 *)ks, nbytes);
+		err = blkcipher_walk_done(desc, &walk, 0);
+	}
+
+	return err;
+}
+
+struct aes_xts_ctx {
+	struct crypto_aes_ctx crypt_ctx;
+	struct crypto_aes_ctx tweak_ctx;
+};
+
+static int xts_setkey(struct crypto_tfm *tfm, const u8 *key,
+		      unsigned int keylen)
+{
+	struct aes_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	u32 *flags = &tfm->crt_flags;
+	int err;
+
+	/* key consists of keys of equal size concatenated, therefore
+	 * the length must be even
+	 */
+	if (keylen % 2) {
+		*flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+
+	/* first half of xts-key is for crypt */
+	err = crypto_aes_expand_key(&ctx->crypt_ctx, key, keylen / 2);
+	if (err)
+		goto bad_key;
+
+	/* second half of xts-key is for tweak */
+	err = crypto_aes_expand_key(&ctx->tweak_ctx, key + keylen / 2,
+				    keylen / 2);
+	if (err)
+		goto bad_key;
+
+	return 0;
+
+bad_key:
+	*flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+	return err;
+}
+
+/* multiply the tweak by x in GF(2^128), little-endian block convention */
+static inline void xts_next_tweak(__le32 *t)
+{
+	u32 carry = le32_to_cpu(t[3]) >> 31;
+
+	t[3] = cpu_to_le32(le32_to_cpu(t[3]) << 1 | le32_to_cpu(t[2]) >> 31);
+	t[2] = cpu_to_le32(le32_to_cpu(t[2]) << 1 | le32_to_cpu(t[1]) >> 31);
+	t[1] = cpu_to_le32(le32_to_cpu(t[1]) << 1 | le32_to_cpu(t[0]) >> 31);
+	t[0] = cpu_to_le32(le32_to_cpu(t[0]) << 1 ^ (carry ? 0x87 : 0));
+}
+
+static int xts_crypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		     struct scatterlist *src, unsigned int nbytes,
+		     void (*fn)(struct crypto_aes_ctx *, u8 *, const u8 *))
+{
+	struct aes_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+	if (!walk.nbytes)
+		return err;
+
+	/* calculate first value of T */
+	aes_arm_enc_blk(&ctx->tweak_ctx, walk.iv, walk.iv);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		do {
+			if (d != s)
+				memcpy(d, s, AES_BLOCK_SIZE);
+			crypto_xor(d, walk.iv, AES_BLOCK_SIZE);
+			fn(&ctx->crypt_ctx, d, d);
+			crypto_xor(d, walk.iv, AES_BLOCK_SIZE);
+			xts_next_tweak((__le32 *)walk.iv);
+			s += AES_BLOCK_SIZE;
+			d += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int xts_encrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	return xts_crypt(desc, dst, src, nbytes, aes_arm_enc_blk);
+}
+
+static int xts_decrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	return xts_crypt(desc, dst, src, nbytes, aes_arm_dec_blk);
+}
+
+/*
+ * Priority 250: above the generic templates wrapped around aes-asm (200),
+ * below the ACE engine (300), which still takes requests it is awake for
+ * and falls back to these for the rest.
+ */
+static struct crypto_alg aes_algs[] = { {
+	.cra_name		= "ecb(aes)",
+	.cra_driver_name	= "ecb-aes-asm",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct crypto_aes_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aes_algs[0].cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.setkey		= aes_setkey,
+			.encrypt	= ecb_encrypt,
+			.decrypt	= ecb_decrypt,
+		},
+	},
+}, {
+	.cra_name		= "cbc(aes)",
+	.cra_driver_name	= "cbc-aes-asm",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct crypto_aes_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aes_algs[1].cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aes_setkey,
+			.encrypt	= cbc_encrypt,
+			.decrypt	= cbc_decrypt,
+		},
+	},
+}, {
+	.cra_name		= "ctr(aes)",
+	.cra_driver_name	= "ctr-aes-asm",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct crypto_aes_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aes_algs[2].cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aes_setkey,
+			.encrypt	= ctr_crypt,
+			.decrypt	= ctr_crypt,
+		},
+	},
+}, {
+	.cra_name		= "xts(aes)",
+	.cra_driver_name	= "xts-aes-asm",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aes_xts_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aes_algs[3].cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= xts_setkey,
+			.encrypt	= xts_encrypt,
+			.decrypt	= xts_decrypt,
+		},
+	},
+} };
+
+static int __init aes_init(void)
+{
+	int err, i;
+
+	err = crypto_register_alg(&aes_alg);
+	if (err)
+		return err;
+
+	for (i = 0; i < ARRAY_SIZE(aes_algs); i++) {
+		err = crypto_register_alg(&aes_algs[i]);
+		if (err)
+			goto err_unregister;
+	}
+
+	return 0;
+
+err_unregister:
+	while (--i >= 0)
+		crypto_unregister_alg(&aes_algs[i]);
+	crypto_unregister_alg(&aes_alg);
+	return err;
+}
+
+static void __exit aes_fini(void)
+{
+	int i;
+
+	for (i = ARRAY_SIZE(aes_algs) - 1; i >= 0; i--)
+		crypto_unregister_alg(&aes_algs[i]);
+	crypto_unregister_alg(&aes_alg);
+}
+
+module_init(aes_init);
+module_exit(aes_fini);
+
+MODULE_DESCRIPTION("Rijndael (AES) Cipher Algorithm, asm optimized");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("aes");
+MODULE_ALIAS("aes-asm");
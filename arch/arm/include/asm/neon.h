@@ -0,0 +1,52 @@
+/*
+ * arch/arm/include/asm/neon.h
+ *
+ * Kernel mode NEON support.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+#include <linux/hardirq.h>
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+#ifdef __ARM_NEON__
+
+/*
+ * If you are affected by the BUILD_BUG below, it probably means that you
+ * are using NEON code /and/ calling the kernel_neon_begin() function from
+ * the same compilation unit. To prevent issues that may arise from GCC
+ * reordering NEON instructions outside of the begin/end region, please
+ * make sure that NEON code lives in a separate compilation unit.
+ */
+#define kernel_neon_begin()	BUILD_BUG_ON(1)
+
+#else
+
+/*
+ * kernel_neon_begin() saves the VFP/NEON state of whichever task
+ * currently owns the unit, enables it and disables preemption.
+ * kernel_neon_end() turns the unit off again; the task state is
+ * restored lazily on its next VFP/NEON instruction.
+ *
+ * NEON may not be used from interrupt context; callers that can run
+ * there must check kernel_neon_allowed() first and fall back to
+ * generic code.
+ */
+void kernel_neon_begin(void);
+
+#endif
+
+void kernel_neon_end(void);
+
+static inline int kernel_neon_allowed(void)
+{
+	return cpu_has_neon() && !in_interrupt();
+}
+
+#endif /* __ASM_ARM_NEON_H */
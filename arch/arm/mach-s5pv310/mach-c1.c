@@ -349,13 +349,19 @@ static void uart_switch_init(void)
 				 S5PV210_UFCON_TXTRIG4 |	\
 				 S5PV210_UFCON_RXTRIG4)
 
+/* UART0 carries the BT HCI link; its 256 byte fifo and the rx timeout
+ * interrupt let it use a deep trigger level without adding latency. */
+#define SMDKC210_UFCON_BT	(S3C2410_UFCON_FIFOMODE |	\
+				 S5PV210_UFCON_TXTRIG4 |	\
+				 S5PV210_UFCON_RXTRIG64)
+
 static struct s3c2410_uartcfg smdkc210_uartcfgs[] __initdata = {
 	[0] = {
 		.hwport		= 0,
-		.flags		= 0,
+		.flags		= S3C2410_UARTCFG_RXDMA,
 		.ucon		= SMDKC210_UCON_DEFAULT,
 		.ulcon		= SMDKC210_ULCON_DEFAULT,
-		.ufcon		= SMDKC210_UFCON_DEFAULT,
+		.ufcon		= SMDKC210_UFCON_BT,
 		.cfg_gpio	= s3c_setup_uart_cfg_gpio,
 	},
 	[1] = {
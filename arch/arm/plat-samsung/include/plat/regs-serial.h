@@ -102,6 +102,8 @@
 #define S3C2410_UCON_RXILEVEL	  (1<<8)
 #define S3C2410_UCON_TXIRQMODE	  (1<<2)
 #define S3C2410_UCON_RXIRQMODE	  (1<<0)
+#define S3C2410_UCON_RXDMAMODE	  (2<<0)
+#define S3C2410_UCON_RXMODEMASK	  (3<<0)
 #define S3C2410_UCON_RXFIFO_TOI	  (1<<7)
 #define S3C2443_UCON_RXERR_IRQEN  (1<<6)
 #define S3C2443_UCON_LOOPBACK	  (1<<5)
@@ -219,6 +221,7 @@
 
 #define S5PV210_UFSTAT_TXFULL	(1<<24)
 #define S5PV210_UFSTAT_RXFULL	(1<<8)
+#define S5PV210_UFSTAT_RXERR	(1<<9)
 #define S5PV210_UFSTAT_TXMASK	(255<<16)
 #define S5PV210_UFSTAT_TXSHIFT	(16)
 #define S5PV210_UFSTAT_RXMASK	(255<<0)
@@ -255,6 +258,9 @@ struct s3c24xx_uart_clksrc {
  * arch/arm/mach-s3c2410/ directory.
 */
 
+/* s3c2410_uartcfg flags */
+#define S3C2410_UARTCFG_RXDMA	(1<<0)	/* stream rx bursts through DMA */
+
 struct s3c2410_uartcfg {
 	unsigned char	   hwport;	 /* hardware port number */
 	unsigned char	   unused;
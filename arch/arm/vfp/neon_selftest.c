@@ -0,0 +1,239 @@
+/*
+ *  linux/arch/arm/vfp/neon_selftest.c
+ *
+ *  Kernel mode NEON self-test and benchmark.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * On load, the NEON block routines are checked against the generic C
+ * code for a range of lengths and alignments on every online CPU, then
+ * the throughput of both is reported together with the cost of a
+ * kernel_neon_begin()/kernel_neon_end() pair. Running a VFP heavy
+ * userspace load at the same time also exercises the lazy state save.
+ */
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+
+#include <asm/neon.h>
+
+#define NEON_TEST_BUF	(64 * 1024)
+#define NEON_TEST_BLOCK	4096
+
+static unsigned int iterations = 256;
+module_param(iterations, uint, S_IRUGO);
+MODULE_PARM_DESC(iterations, "Passes over the buffer per benchmark");
+
+extern void neon_xor_2(unsigned long bytes, unsigned long *p1,
+		       const unsigned long *p2);
+extern void neon_copy(void *dst, const void *src, unsigned long bytes);
+
+static void generic_xor_2(unsigned long bytes, unsigned long *p1,
+			  const unsigned long *p2)
+{
+	unsigned long lines = bytes / sizeof(unsigned long);
+
+	while (lines--)
+		*p1++ ^= *p2++;
+}
+
+struct neon_test {
+	struct completion done;
+	int err;
+};
+
+static void neon_test_fill(u8 *p, unsigned int len, u32 seed)
+{
+	while (len--) {
+		seed = seed * 1103515245 + 12345;
+		*p++ = seed >> 16;
+	}
+}
+
+static int neon_test_check(u8 *buf)
+{
+	u8 *a = buf, *b = buf + NEON_TEST_BUF, *c = buf + 2 * NEON_TEST_BUF;
+	unsigned int len, off;
+
+	for (len = 64; len <= NEON_TEST_BLOCK; len += 64) {
+		for (off = 0; off < 16; off += 4) {
+			neon_test_fill(a, len + off, len);
+			neon_test_fill(b, len + off, ~len);
+			memcpy(c, a, len + off);
+
+			generic_xor_2(len, (unsigned long *)(c + off),
+				      (unsigned long *)(b + off));
+
+			kernel_neon_begin();
+			neon_xor_2(len, (unsigned long *)(a + off),
+				   (unsigned long *)(b + off));
+			kernel_neon_end();
+
+			if (memcmp(a, c, len + off)) {
+				printk(KERN_ERR "neon_test: xor mismatch, "
+				       "len %u off %u\n", len, off);
+				return -EIO;
+			}
+
+			kernel_neon_begin();
+			neon_copy(c + off, b + off, len);
+			kernel_neon_end();
+
+			if (memcmp(c + off, b + off, len)) {
+				printk(KERN_ERR "neon_test: copy mismatch, "
+				       "len %u off %u\n", len, off);
+				return -EIO;
+			}
+		}
+		cond_resched();
+	}
+
+	return 0;
+}
+
+static int neon_test_thread(void *data)
+{
+	struct neon_test *t = data;
+	u8 *buf;
+
+	buf = kmalloc(3 * NEON_TEST_BUF, GFP_KERNEL);
+	if (!buf) {
+		t->err = -ENOMEM;
+	} else {
+		t->err = neon_test_check(buf);
+		kfree(buf);
+	}
+
+	complete(&t->done);
+	return 0;
+}
+
+static unsigned long neon_test_rate(s64 ns)
+{
+	u64 bytes = (u64)iterations * NEON_TEST_BUF;
+
+	if (ns <= 0)
+		return 0;
+
+	/* KB/s */
+	return (unsigned long)div64_u64(bytes * NSEC_PER_SEC, (u64)ns * 1024);
+}
+
+static void neon_test_bench(u8 *buf)
+{
+	unsigned long *p1 = (unsigned long *)buf;
+	unsigned long *p2 = (unsigned long *)(buf + NEON_TEST_BUF);
+	unsigned int i, off;
+	ktime_t start;
+	s64 generic, neon, copy, pair;
+
+	neon_test_fill(buf, 2 * NEON_TEST_BUF, 0);
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++)
+		for (off = 0; off < NEON_TEST_BUF; off += NEON_TEST_BLOCK)
+			generic_xor_2(NEON_TEST_BLOCK, p1 + off / sizeof(long),
+				      p2 + off / sizeof(long));
+	generic = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++)
+		for (off = 0; off < NEON_TEST_BUF; off += NEON_TEST_BLOCK) {
+			kernel_neon_begin();
+			neon_xor_2(NEON_TEST_BLOCK, p1 + off / sizeof(long),
+				   p2 + off / sizeof(long));
+			kernel_neon_end();
+		}
+	neon = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++)
+		for (off = 0; off < NEON_TEST_BUF; off += NEON_TEST_BLOCK) {
+			kernel_neon_begin();
+			neon_copy(buf + off, buf + NEON_TEST_BUF + off,
+				  NEON_TEST_BLOCK);
+			kernel_neon_end();
+		}
+	copy = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		kernel_neon_begin();
+		kernel_neon_end();
+	}
+	pair = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	printk(KERN_INFO "neon_test: xor generic %lu KB/s, neon %lu KB/s\n",
+	       neon_test_rate(generic), neon_test_rate(neon));
+	printk(KERN_INFO "neon_test: copy neon %lu KB/s\n",
+	       neon_test_rate(copy));
+	printk(KERN_INFO "neon_test: begin/end pair %lu ns\n",
+	       (unsigned long)div64_u64(pair, iterations ? : 1));
+}
+
+static int __init neon_test_init(void)
+{
+	struct neon_test t;
+	struct task_struct *task;
+	unsigned int cpu;
+	u8 *buf;
+	int err = 0;
+
+	if (!cpu_has_neon()) {
+		printk(KERN_INFO "neon_test: no NEON unit\n");
+		return -ENODEV;
+	}
+
+	for_each_online_cpu(cpu) {
+		init_completion(&t.done);
+		t.err = 0;
+
+		task = kthread_create(neon_test_thread, &t, "neon_test/%u", cpu);
+		if (IS_ERR(task))
+			return PTR_ERR(task);
+
+		kthread_bind(task, cpu);
+		wake_up_process(task);
+		wait_for_completion(&t.done);
+
+		if (t.err) {
+			printk(KERN_ERR "neon_test: cpu%u failed (%d)\n",
+			       cpu, t.err);
+			err = t.err;
+		}
+	}
+
+	if (err)
+		return err;
+
+	printk(KERN_INFO "neon_test: self-test passed\n");
+
+	buf = kmalloc(2 * NEON_TEST_BUF, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	neon_test_bench(buf);
+	kfree(buf);
+
+	return 0;
+}
+
+static void __exit neon_test_exit(void)
+{
+}
+
+module_init(neon_test_init);
+module_exit(neon_test_exit);
+
+MODULE_DESCRIPTION("Kernel mode NEON self-test and benchmark");
+MODULE_LICENSE("GPL");
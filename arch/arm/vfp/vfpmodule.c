@@ -14,6 +14,7 @@
 #include <linux/signal.h>
 #include <linux/sched.h>
 #include <linux/init.h>
+#include <linux/hardirq.h>
 
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
@@ -483,6 +484,55 @@ void vfp_flush_hwstate(struct thread_info *thread)
 	put_cpu();
 }
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+
+/*
+ * Kernel-side NEON support functions
+ */
+void kernel_neon_begin(void)
+{
+	unsigned int cpu;
+	u32 fpexc;
+
+	/*
+	 * Kernel mode NEON is only allowed outside of interrupt context
+	 * with preemption disabled. This will make sure that the kernel
+	 * mode NEON register contents never need to be preserved.
+	 */
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+
+	fpexc = fmrx(FPEXC);
+	fmxr(FPEXC, fpexc | FPEXC_EN);
+
+	/*
+	 * Save the state of the task that owns the hardware registers, if
+	 * it is still live there. On SMP the owner's state has already been
+	 * saved on the last context switch unless the unit is enabled, in
+	 * which case the owner is the current task.
+	 */
+	if (last_VFP_context[cpu]) {
+#ifdef CONFIG_SMP
+		if (fpexc & FPEXC_EN)
+#endif
+			vfp_save_state(last_VFP_context[cpu], fpexc | FPEXC_EN);
+	}
+
+	/* force a reload on the next VFP/NEON use by any task */
+	last_VFP_context[cpu] = NULL;
+}
+EXPORT_SYMBOL(kernel_neon_begin);
+
+void kernel_neon_end(void)
+{
+	/* Disable the NEON/VFP unit. */
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	put_cpu();
+}
+EXPORT_SYMBOL(kernel_neon_end);
+
+#endif /* CONFIG_KERNEL_MODE_NEON */
+
 #include <linux/smp.h>
 
 /*
@@ -64,6 +64,9 @@
 
 #define SO_RXQ_OVFL             40
 
+/* Private option, kept well away from the numbers upstream hands out */
+#define SO_RCVDEFER             0x5244
+
 #endif /* _ASM_SOCKET_H */
 
 
@@ -71,4 +71,7 @@
 
 #define SO_RXQ_OVFL             40
 
+/* Private option, kept well away from the numbers upstream hands out */
+#define SO_RCVDEFER             0x5244
+
 #endif /* _ASM_IA64_SOCKET_H */
@@ -62,4 +62,7 @@
 
 #define SO_RXQ_OVFL             40
 
+/* Private option, kept well away from the numbers upstream hands out */
+#define SO_RCVDEFER             0x5244
+
 #endif /* _ASM_M32R_SOCKET_H */
@@ -33,6 +33,9 @@
 #include <linux/delay.h>
 #include <linux/version.h>
 #include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/log2.h>
 
 #include <asm/cacheflush.h>
 
@@ -48,9 +51,17 @@
 
 #define CONFIG_ACE_AES_MIN_BLOCK_SIZE	16
 
+/* requests served back to back per engine wakeup in async mode */
+#define ACE_BC_QUEUE_LEN		32
+
 #define CONFIG_ACE_AES_FALLBACK
+#define CONFIG_ACE_BC_DISPATCH		/* route by measured throughput */
 
+#if defined(CONFIG_CRYPTO_DEV_S5P_ACE_BC_ASYNC)
+#define CONFIG_ACE_BC_ASYNC		/* queue and batch per wakeup */
+#else
 #undef CONFIG_ACE_BC_ASYNC
+#endif
 #undef CONFIG_ACE_BC_IRQMODE
 
 #define CONFIG_ACE_HASH
@@ -75,6 +86,10 @@
 #undef CONFIG_ACE_HASH_IRQMODE
 #endif
 
+#if !defined(CONFIG_ACE_AES_FALLBACK)
+#undef CONFIG_ACE_BC_DISPATCH
+#endif
+
 #if !defined(CONFIG_ACE_HASH)
 #undef CONFIG_ACE_HASH_ASYNC
 #undef CONFIG_ACE_HASH_IRQMODE
@@ -127,6 +142,9 @@ struct timeval timestamp[5];
 
 struct s5p_ace_reqctx {
 	u32				mode;
+#if defined(CONFIG_ACE_BC_DISPATCH)
+	ktime_t				start;
+#endif
 };
 
 struct s5p_ace_device {
@@ -1061,6 +1079,149 @@ static int s5p_ace_aes_crypt_dma_wait(struct s5p_ace_device *dev)
 	return ret;
 }
 
+#if defined(CONFIG_ACE_BC_DISPATCH)
+/*
+ * Hybrid software/hardware dispatch
+ *
+ * Small requests pay for clock ungating, cache maintenance and the wait
+ * for the engine, which costs more than running the fallback cipher on
+ * the CPU. Both paths are timed per power-of-two size class and each
+ * request goes to whichever currently has the lower cost per KB; every
+ * ACE_DISPATCH_PROBE-th request in a class takes the other path so the
+ * estimates follow changes in CPU frequency and engine load.
+ *
+ * Updates to the estimates are not locked; a lost update only delays
+ * the average by one sample.
+ */
+#define ACE_DISPATCH_MIN_SHIFT	4	/* 16 bytes */
+#define ACE_DISPATCH_BUCKETS	13	/* up to 64KB and beyond */
+#define ACE_DISPATCH_PROBE	32
+#define ACE_DISPATCH_EWMA_SHIFT	3
+
+enum {
+	ACE_DISPATCH_AUTO,
+	ACE_DISPATCH_HW,
+	ACE_DISPATCH_SW,
+};
+
+static int dispatch_mode = ACE_DISPATCH_AUTO;
+module_param(dispatch_mode, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dispatch_mode, "0: by measured throughput, 1: ACE, 2: CPU");
+
+struct s5p_ace_dispatch_stat {
+	u32		requests;
+	u32		hw_count;
+	u32		sw_count;
+	u32		hw_ns_kb;	/* ns per KB, moving average */
+	u32		sw_ns_kb;
+};
+
+static struct s5p_ace_dispatch_stat s5p_ace_dispatch[ACE_DISPATCH_BUCKETS];
+
+static int s5p_ace_dispatch_bucket(unsigned int nbytes)
+{
+	int bucket = nbytes ? ilog2(nbytes) - ACE_DISPATCH_MIN_SHIFT : 0;
+
+	return clamp(bucket, 0, ACE_DISPATCH_BUCKETS - 1);
+}
+
+static int s5p_ace_dispatch_use_hw(int bucket)
+{
+	struct s5p_ace_dispatch_stat *st = &s5p_ace_dispatch[bucket];
+	int faster_hw;
+
+	if (dispatch_mode == ACE_DISPATCH_HW)
+		return 1;
+	if (dispatch_mode == ACE_DISPATCH_SW)
+		return 0;
+
+	/* get one sample of each path first */
+	if (!st->sw_ns_kb)
+		return 0;
+	if (!st->hw_ns_kb)
+		return 1;
+
+	faster_hw = st->hw_ns_kb <= st->sw_ns_kb;
+	if (++st->requests % ACE_DISPATCH_PROBE == 0)
+		return !faster_hw;
+
+	return faster_hw;
+}
+
+static void s5p_ace_dispatch_account(int bucket, int hw, ktime_t start,
+				     unsigned int nbytes)
+{
+	struct s5p_ace_dispatch_stat *st = &s5p_ace_dispatch[bucket];
+	s64 delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+	u32 *avg = hw ? &st->hw_ns_kb : &st->sw_ns_kb;
+	u32 sample;
+
+	if (hw)
+		st->hw_count++;
+	else
+		st->sw_count++;
+
+	if (!nbytes || delta <= 0)
+		return;
+
+	sample = (u32)min_t(u64, div_u64((u64)delta * 1024, nbytes),
+			    0xffffffffULL);
+	if (!*avg)
+		*avg = sample ? sample : 1;
+	else
+		*avg += ((s32)(sample - *avg)) >> ACE_DISPATCH_EWMA_SHIFT;
+}
+
+static int s5p_ace_aes_crypt_sw(struct s5p_ace_aes_ctx *sctx, void *iv,
+				u32 flags, struct scatterlist *dst,
+				struct scatterlist *src, unsigned int nbytes,
+				int encmode)
+{
+	struct blkcipher_desc desc;
+
+	desc.tfm = sctx->fallback_bc;
+	desc.info = iv;
+	desc.flags = flags;
+
+	if (encmode == BC_MODE_ENC)
+		return crypto_blkcipher_encrypt_iv(&desc, dst, src, nbytes);
+	else
+		return crypto_blkcipher_decrypt_iv(&desc, dst, src, nbytes);
+}
+
+static ssize_t s5p_ace_show_dispatch(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct s5p_ace_dispatch_stat *st;
+	ssize_t len = 0;
+	int i;
+
+	len += sprintf(buf + len, "%-8s %10s %10s %10s %10s\n", "size",
+		       "hw_reqs", "hw_ns/KB", "sw_reqs", "sw_ns/KB");
+	for (i = 0; i < ACE_DISPATCH_BUCKETS; i++) {
+		st = &s5p_ace_dispatch[i];
+		len += sprintf(buf + len, "%-8u %10u %10u %10u %10u\n",
+			       1U << (i + ACE_DISPATCH_MIN_SHIFT),
+			       st->hw_count, st->hw_ns_kb,
+			       st->sw_count, st->sw_ns_kb);
+	}
+
+	return len;
+}
+
+static ssize_t s5p_ace_store_dispatch(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	/* any write resets the estimates */
+	memset(s5p_ace_dispatch, 0, sizeof(s5p_ace_dispatch));
+	return count;
+}
+
+static DEVICE_ATTR(dispatch, S_IRUGO | S_IWUSR,
+		   s5p_ace_show_dispatch, s5p_ace_store_dispatch);
+#endif
+
 #if defined(CONFIG_ACE_BC_ASYNC)
 static int s5p_ace_aes_handle_req(struct s5p_ace_device *dev)
 {
@@ -1135,6 +1296,11 @@ static int s5p_ace_aes_handle_req(struct s5p_ace_device *dev)
 	rctx = ablkcipher_request_ctx(req);
 	s5p_ace_aes_set_encmode(sctx, rctx->mode);
 
+#if defined(CONFIG_ACE_BC_DISPATCH)
+	/* time the engine only, not the wait in the queue */
+	rctx->start = ktime_get();
+#endif
+
 	dev->ctx_bc = sctx;
 
 start:
@@ -1162,6 +1328,13 @@ static void s5p_ace_bc_task(unsigned long data)
 	}
 
 	if (!sctx->total) {
+#if defined(CONFIG_ACE_BC_DISPATCH)
+		struct s5p_ace_reqctx *rctx = ablkcipher_request_ctx(sctx->req);
+
+		s5p_ace_dispatch_account(
+			s5p_ace_dispatch_bucket(sctx->req->nbytes), 1,
+			rctx->start, sctx->req->nbytes);
+#endif
 		if ((sctx->sfr_ctrl & ACE_AES_OPERMODE_MASK)
 				!= ACE_AES_OPERMODE_ECB)
 			memcpy(sctx->req->info, sctx->sfr_semikey,
@@ -1193,6 +1366,22 @@ static int s5p_ace_aes_crypt(struct ablkcipher_request *req, u32 encmode)
 
 	rctx->mode = encmode;
 
+#if defined(CONFIG_ACE_BC_DISPATCH)
+	if (!s5p_ace_dispatch_use_hw(s5p_ace_dispatch_bucket(req->nbytes))) {
+		struct s5p_ace_aes_ctx *sctx =
+			crypto_ablkcipher_ctx(crypto_ablkcipher_reqtfm(req));
+		ktime_t start = ktime_get();
+
+		/* completes synchronously, no need to queue */
+		ret = s5p_ace_aes_crypt_sw(sctx, req->info, req->base.flags,
+					   req->dst, req->src, req->nbytes,
+					   encmode);
+		s5p_ace_dispatch_account(s5p_ace_dispatch_bucket(req->nbytes),
+					 0, start, req->nbytes);
+		return ret;
+	}
+#endif
+
 	timeout = jiffies + msecs_to_jiffies(10);
 	while (time_before(jiffies, timeout)) {
 		if (s5p_ace_dev.queue_bc.list.prev != &req->base.list)
@@ -1230,6 +1419,18 @@ static int s5p_ace_aes_crypt(struct blkcipher_desc *desc,
 {
 	struct s5p_ace_aes_ctx *sctx = crypto_blkcipher_ctx(desc->tfm);
 	int ret;
+#if defined(CONFIG_ACE_BC_DISPATCH)
+	int bucket = s5p_ace_dispatch_bucket(nbytes);
+	ktime_t start;
+
+	if (!s5p_ace_dispatch_use_hw(bucket)) {
+		start = ktime_get();
+		ret = s5p_ace_aes_crypt_sw(sctx, desc->info, desc->flags,
+					   dst, src, nbytes, encmode);
+		s5p_ace_dispatch_account(bucket, 0, start, nbytes);
+		return ret;
+	}
+#endif
 
 #if defined(CONFIG_ACE_HEARTBEAT) || defined(CONFIG_ACE_WATCHDOG)
 	do_gettimeofday(&timestamp[0]);		/* 0: request */
@@ -1255,6 +1456,10 @@ static int s5p_ace_aes_crypt(struct blkcipher_desc *desc,
 	s5p_ace_resume_device(&s5p_ace_dev);
 	while (test_and_set_bit(FLAGS_BC_BUSY, &s5p_ace_dev.flags))
 		schedule();
+#if defined(CONFIG_ACE_BC_DISPATCH)
+	/* time the engine only, not the wait for another user */
+	start = ktime_get();
+#endif
 	s5p_ace_clock_gating(ACE_CLOCK_ON);
 
 	s5p_ace_dev.ctx_bc = sctx;
@@ -1278,6 +1483,10 @@ static int s5p_ace_aes_crypt(struct blkcipher_desc *desc,
 	hrtimer_cancel(&s5p_ace_dev.watchdog_bc);
 #endif
 
+#if defined(CONFIG_ACE_BC_DISPATCH)
+	s5p_ace_dispatch_account(bucket, 1, start, nbytes);
+#endif
+
 	return ret;
 }
 #endif
@@ -2141,7 +2350,7 @@ static int __init s5p_ace_probe(struct platform_device *pdev)
 #endif
 
 #if defined(CONFIG_ACE_BC_ASYNC)
-	crypto_init_queue(&s5p_adt->queue_bc, 1);
+	crypto_init_queue(&s5p_adt->queue_bc, ACE_BC_QUEUE_LEN);
 	tasklet_init(&s5p_adt->task_bc, s5p_ace_bc_task,
 			(unsigned long)s5p_adt);
 #endif
@@ -2188,6 +2397,11 @@ static int __init s5p_ace_probe(struct platform_device *pdev)
 	}
 #endif
 
+#if defined(CONFIG_ACE_BC_DISPATCH)
+	if (device_create_file(&pdev->dev, &dev_attr_dispatch))
+		dev_warn(&pdev->dev, "failed to create dispatch attribute\n");
+#endif
+
 	printk(KERN_NOTICE "ACE driver is initialized\n");
 
 	return 0;
@@ -2242,6 +2456,10 @@ static int s5p_ace_remove(struct platform_device *dev)
 	hrtimer_cancel(&s5p_adt->heartbeat);
 #endif
 
+#if defined(CONFIG_ACE_BC_DISPATCH)
+	device_remove_file(&dev->dev, &dev_attr_dispatch);
+#endif
+
 #if defined(CONFIG_ACE_BC_IRQMODE) || defined(CONFIG_ACE_HASH_IRQMODE)
 	if (s5p_adt->irq) {
 		free_irq(s5p_adt->irq, (void *)s5p_adt);
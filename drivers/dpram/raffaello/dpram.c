@@ -351,11 +351,22 @@ static inline void _memcpy(void *p_dest, const void *p_src, int size)
     }
     else
     {
-        volatile u16 *d = (u16 *)dest;
-        u16          *s = (u16 *)src;
+        volatile u16       *d = (u16 *)dest;
+        const volatile u16 *s = (const u16 *)src;
 
         size >>= 1;
 
+        // Burst the bulk of the copy. Both sides are volatile so that the
+        // compiler can't merge the accesses; the window only sees 16-bit ones.
+        while (size >= 8)
+        {
+            d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = s[3];
+            d[4] = s[4]; d[5] = s[5]; d[6] = s[6]; d[7] = s[7];
+            d += 8;
+            s += 8;
+            size -= 8;
+        }
+
         while (size--)
         {
             *d++ = *s++;
@@ -18,6 +18,10 @@
 #include <linux/crypto.h>
 #include <linux/workqueue.h>
 #include <linux/backing-dev.h>
+#include <linux/cpumask.h>
+#include <linux/hardirq.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <asm/atomic.h>
 #include <linux/scatterlist.h>
 #include <asm/page.h>
@@ -41,6 +45,8 @@ struct convert_context {
 	unsigned int idx_out;
 	sector_t sector;
 	atomic_t pending;
+	struct ablkcipher_request *req;
+	struct crypt_tfm_set *set;
 };
 
 /*
@@ -63,6 +69,7 @@ struct dm_crypt_request {
 	struct convert_context *ctx;
 	struct scatterlist sg_in;
 	struct scatterlist sg_out;
+	sector_t iv_sector;
 };
 
 struct crypt_config;
@@ -73,11 +80,11 @@ struct crypt_iv_operations {
 	void (*dtr)(struct crypt_config *cc);
 	int (*init)(struct crypt_config *cc);
 	int (*wipe)(struct crypt_config *cc);
-	int (*generator)(struct crypt_config *cc, u8 *iv, sector_t sector);
+	int (*generator)(struct crypt_config *cc, u8 *iv,
+			 struct dm_crypt_request *dmreq);
 };
 
 struct iv_essiv_private {
-	struct crypto_cipher *tfm;
 	struct crypto_hash *hash_tfm;
 	u8 *salt;
 };
@@ -86,11 +93,40 @@ struct iv_benbi_private {
 	int shift;
 };
 
+/*
+ * One set of cipher state: the bulk cipher and the IV generator's tfm.
+ *
+ * Cipher drivers may keep per-request state in the tfm context, so a
+ * set must never be used by two threads at the same time.
+ */
+struct crypt_tfm_set {
+	struct crypto_ablkcipher *tfm;
+
+	/* ESSIV: struct crypto_cipher *essiv_tfm */
+	void *iv_private;
+};
+
+enum { CRYPT_SET_KCRYPTD, CRYPT_SET_INLINE, CRYPT_SET_MAX };
+
+/*
+ * Duplicated per-CPU state for cipher.
+ *
+ * The kcryptd set belongs to this CPU's kcryptd thread.  The inline set
+ * only exists with no_read_workqueue.  It is used by reads decrypted in
+ * their completion context, which is not bound to the CPU, so it is
+ * taken under inline_lock.
+ */
+struct crypt_cpu {
+	struct crypt_tfm_set set[CRYPT_SET_MAX];
+	struct mutex inline_lock;
+};
+
 /*
  * Crypt: maps a linear range of a block device
  * and encrypts / decrypts at the same time.
  */
-enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID };
+enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID,
+	     DM_CRYPT_SAME_CPU, DM_CRYPT_NO_READ_WORKQUEUE };
 struct crypt_config {
 	struct dm_dev *dev;
 	sector_t start;
@@ -106,6 +142,7 @@ struct crypt_config {
 
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
+	atomic_t next_cpu;
 
 	/*
 	 * crypto related data
@@ -133,11 +170,11 @@ struct crypt_config {
 	 * correctly aligned.
 	 */
 	unsigned int dmreq_start;
-	struct ablkcipher_request *req;
+
+	struct crypt_cpu __percpu *cpu;
 
 	char cipher[CRYPTO_MAX_ALG_NAME];
 	char chainmode[CRYPTO_MAX_ALG_NAME];
-	struct crypto_ablkcipher *tfm;
 	unsigned long flags;
 	unsigned int key_size;
 	u8 key[0];
@@ -151,6 +188,37 @@ static struct kmem_cache *_crypt_io_pool;
 
 static void clone_init(struct dm_crypt_io *, struct bio *);
 static void kcryptd_queue_crypt(struct dm_crypt_io *io);
+static void kcryptd_crypt_read_inline(struct dm_crypt_io *io);
+
+/*
+ * Only kcryptd converts data, and its threads are bound to their CPU,
+ * so this_cpu_ptr() stays valid for the whole conversion.
+ */
+static struct crypt_cpu *this_crypt_config(struct crypt_config *cc)
+{
+	return this_cpu_ptr(cc->cpu);
+}
+
+/*
+ * Use this to access cipher attributes that are the same for each CPU.
+ */
+static struct crypto_ablkcipher *any_tfm(struct crypt_config *cc)
+{
+	return __this_cpu_ptr(cc->cpu)->set[CRYPT_SET_KCRYPTD].tfm;
+}
+
+/* Number of tfm sets allocated on each CPU */
+static int crypt_nr_sets(struct crypt_config *cc)
+{
+	return test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags) ?
+	       CRYPT_SET_MAX : CRYPT_SET_KCRYPTD + 1;
+}
+
+static struct crypt_tfm_set *crypt_cpu_set(struct crypt_config *cc,
+					   int cpu, int i)
+{
+	return &per_cpu_ptr(cc->cpu, cpu)->set[i];
+}
 
 /*
  * Different IV generation algorithms:
@@ -175,19 +243,20 @@ static void kcryptd_queue_crypt(struct dm_crypt_io *io);
  * http://article.gmane.org/gmane.linux.kernel.device-mapper.dm-crypt/454
  */
 
-static int crypt_iv_plain_gen(struct crypt_config *cc, u8 *iv, sector_t sector)
+static int crypt_iv_plain_gen(struct crypt_config *cc, u8 *iv,
+			      struct dm_crypt_request *dmreq)
 {
 	memset(iv, 0, cc->iv_size);
-	*(u32 *)iv = cpu_to_le32(sector & 0xffffffff);
+	*(u32 *)iv = cpu_to_le32(dmreq->iv_sector & 0xffffffff);
 
 	return 0;
 }
 
 static int crypt_iv_plain64_gen(struct crypt_config *cc, u8 *iv,
-				sector_t sector)
+				struct dm_crypt_request *dmreq)
 {
 	memset(iv, 0, cc->iv_size);
-	*(u64 *)iv = cpu_to_le64(sector);
+	*(u64 *)iv = cpu_to_le64(dmreq->iv_sector);
 
 	return 0;
 }
@@ -198,7 +267,8 @@ static int crypt_iv_essiv_init(struct crypt_config *cc)
 	struct iv_essiv_private *essiv = &cc->iv_gen_private.essiv;
 	struct hash_desc desc;
 	struct scatterlist sg;
-	int err;
+	struct crypto_cipher *essiv_tfm;
+	int err, cpu, i;
 
 	sg_init_one(&sg, cc->key, cc->key_size);
 	desc.tfm = essiv->hash_tfm;
@@ -208,8 +278,17 @@ static int crypt_iv_essiv_init(struct crypt_config *cc)
 	if (err)
 		return err;
 
-	return crypto_cipher_setkey(essiv->tfm, essiv->salt,
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < crypt_nr_sets(cc); i++) {
+			essiv_tfm = crypt_cpu_set(cc, cpu, i)->iv_private;
+
+			err = crypto_cipher_setkey(essiv_tfm, essiv->salt,
 				    crypto_hash_digestsize(essiv->hash_tfm));
+			if (err)
+				return err;
+		}
+
+	return 0;
 }
 
 /* Wipe salt and reset key derived from volume key */
@@ -217,18 +296,36 @@ static int crypt_iv_essiv_wipe(struct crypt_config *cc)
 {
 	struct iv_essiv_private *essiv = &cc->iv_gen_private.essiv;
 	unsigned salt_size = crypto_hash_digestsize(essiv->hash_tfm);
+	struct crypto_cipher *essiv_tfm;
+	int cpu, i, r, err = 0;
 
 	memset(essiv->salt, 0, salt_size);
 
-	return crypto_cipher_setkey(essiv->tfm, essiv->salt, salt_size);
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < crypt_nr_sets(cc); i++) {
+			essiv_tfm = crypt_cpu_set(cc, cpu, i)->iv_private;
+			r = crypto_cipher_setkey(essiv_tfm, essiv->salt,
+						 salt_size);
+			if (r)
+				err = r;
+		}
+
+	return err;
 }
 
 static void crypt_iv_essiv_dtr(struct crypt_config *cc)
 {
 	struct iv_essiv_private *essiv = &cc->iv_gen_private.essiv;
-
-	crypto_free_cipher(essiv->tfm);
-	essiv->tfm = NULL;
+	struct crypt_tfm_set *set;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < CRYPT_SET_MAX; i++) {
+			set = crypt_cpu_set(cc, cpu, i);
+			if (set->iv_private)
+				crypto_free_cipher(set->iv_private);
+			set->iv_private = NULL;
+		}
 
 	crypto_free_hash(essiv->hash_tfm);
 	essiv->hash_tfm = NULL;
@@ -237,13 +334,36 @@ static void crypt_iv_essiv_dtr(struct crypt_config *cc)
 	essiv->salt = NULL;
 }
 
+/* Allocate one ESSIV cipher, the salt is set later by crypt_iv_essiv_init */
+static struct crypto_cipher *setup_essiv_cpu(struct crypt_config *cc,
+					     struct dm_target *ti)
+{
+	struct crypto_cipher *essiv_tfm;
+
+	essiv_tfm = crypto_alloc_cipher(cc->cipher, 0, CRYPTO_ALG_ASYNC);
+	if (IS_ERR(essiv_tfm)) {
+		ti->error = "Error allocating crypto tfm for ESSIV";
+		return essiv_tfm;
+	}
+
+	if (crypto_cipher_blocksize(essiv_tfm) !=
+	    crypto_ablkcipher_ivsize(any_tfm(cc))) {
+		ti->error = "Block size of ESSIV cipher does "
+			    "not match IV size of block cipher";
+		crypto_free_cipher(essiv_tfm);
+		return ERR_PTR(-EINVAL);
+	}
+
+	return essiv_tfm;
+}
+
 static int crypt_iv_essiv_ctr(struct crypt_config *cc, struct dm_target *ti,
 			      const char *opts)
 {
-	struct crypto_cipher *essiv_tfm = NULL;
+	struct crypto_cipher *essiv_tfm;
 	struct crypto_hash *hash_tfm = NULL;
 	u8 *salt = NULL;
-	int err;
+	int err, cpu, i;
 
 	if (!opts) {
 		ti->error = "Digest algorithm missing for ESSIV mode";
@@ -265,48 +385,44 @@ static int crypt_iv_essiv_ctr(struct crypt_config *cc, struct dm_target *ti,
 		goto bad;
 	}
 
-	/* Allocate essiv_tfm */
-	essiv_tfm = crypto_alloc_cipher(cc->cipher, 0, CRYPTO_ALG_ASYNC);
-	if (IS_ERR(essiv_tfm)) {
-		ti->error = "Error allocating crypto tfm for ESSIV";
-		err = PTR_ERR(essiv_tfm);
-		goto bad;
-	}
-	if (crypto_cipher_blocksize(essiv_tfm) !=
-	    crypto_ablkcipher_ivsize(cc->tfm)) {
-		ti->error = "Block size of ESSIV cipher does "
-			    "not match IV size of block cipher";
-		err = -EINVAL;
-		goto bad;
-	}
-
 	cc->iv_gen_private.essiv.salt = salt;
-	cc->iv_gen_private.essiv.tfm = essiv_tfm;
 	cc->iv_gen_private.essiv.hash_tfm = hash_tfm;
 
+	/* Allocate one essiv_tfm per tfm set, like the block cipher */
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < crypt_nr_sets(cc); i++) {
+			essiv_tfm = setup_essiv_cpu(cc, ti);
+			if (IS_ERR(essiv_tfm)) {
+				crypt_iv_essiv_dtr(cc);
+				return PTR_ERR(essiv_tfm);
+			}
+			crypt_cpu_set(cc, cpu, i)->iv_private = essiv_tfm;
+		}
+
 	return 0;
 
 bad:
-	if (essiv_tfm && !IS_ERR(essiv_tfm))
-		crypto_free_cipher(essiv_tfm);
 	if (hash_tfm && !IS_ERR(hash_tfm))
 		crypto_free_hash(hash_tfm);
 	kfree(salt);
 	return err;
 }
 
-static int crypt_iv_essiv_gen(struct crypt_config *cc, u8 *iv, sector_t sector)
+static int crypt_iv_essiv_gen(struct crypt_config *cc, u8 *iv,
+			      struct dm_crypt_request *dmreq)
 {
+	struct crypto_cipher *essiv_tfm = dmreq->ctx->set->iv_private;
+
 	memset(iv, 0, cc->iv_size);
-	*(u64 *)iv = cpu_to_le64(sector);
-	crypto_cipher_encrypt_one(cc->iv_gen_private.essiv.tfm, iv, iv);
+	*(u64 *)iv = cpu_to_le64(dmreq->iv_sector);
+	crypto_cipher_encrypt_one(essiv_tfm, iv, iv);
 	return 0;
 }
 
 static int crypt_iv_benbi_ctr(struct crypt_config *cc, struct dm_target *ti,
 			      const char *opts)
 {
-	unsigned bs = crypto_ablkcipher_blocksize(cc->tfm);
+	unsigned bs = crypto_ablkcipher_blocksize(any_tfm(cc));
 	int log = ilog2(bs);
 
 	/* we need to calculate how far we must shift the sector count
@@ -331,19 +447,22 @@ static void crypt_iv_benbi_dtr(struct crypt_config *cc)
 {
 }
 
-static int crypt_iv_benbi_gen(struct crypt_config *cc, u8 *iv, sector_t sector)
+static int crypt_iv_benbi_gen(struct crypt_config *cc, u8 *iv,
+			      struct dm_crypt_request *dmreq)
 {
 	__be64 val;
 
 	memset(iv, 0, cc->iv_size - sizeof(u64)); /* rest is cleared below */
 
-	val = cpu_to_be64(((u64)sector << cc->iv_gen_private.benbi.shift) + 1);
+	val = cpu_to_be64(((u64)dmreq->iv_sector <<
+			   cc->iv_gen_private.benbi.shift) + 1);
 	put_unaligned(val, (__be64 *)(iv + cc->iv_size - sizeof(u64)));
 
 	return 0;
 }
 
-static int crypt_iv_null_gen(struct crypt_config *cc, u8 *iv, sector_t sector)
+static int crypt_iv_null_gen(struct crypt_config *cc, u8 *iv,
+			     struct dm_crypt_request *dmreq)
 {
 	memset(iv, 0, cc->iv_size);
 
@@ -415,9 +534,10 @@ static int crypt_convert_block(struct crypt_config *cc,
 
 	dmreq = dmreq_of_req(cc, req);
 	iv = (u8 *)ALIGN((unsigned long)(dmreq + 1),
-			 crypto_ablkcipher_alignmask(cc->tfm) + 1);
+			 crypto_ablkcipher_alignmask(any_tfm(cc)) + 1);
 
 	dmreq->ctx = ctx;
+	dmreq->iv_sector = ctx->sector;
 	sg_init_table(&dmreq->sg_in, 1);
 	sg_set_page(&dmreq->sg_in, bv_in->bv_page, 1 << SECTOR_SHIFT,
 		    bv_in->bv_offset + ctx->offset_in);
@@ -439,7 +559,7 @@ static int crypt_convert_block(struct crypt_config *cc,
 	}
 
 	if (cc->iv_gen_ops) {
-		r = cc->iv_gen_ops->generator(cc, iv, ctx->sector);
+		r = cc->iv_gen_ops->generator(cc, iv, dmreq);
 		if (r < 0)
 			return r;
 	}
@@ -460,13 +580,13 @@ static void kcryptd_async_done(struct crypto_async_request *async_req,
 static void crypt_alloc_req(struct crypt_config *cc,
 			    struct convert_context *ctx)
 {
-	if (!cc->req)
-		cc->req = mempool_alloc(cc->req_pool, GFP_NOIO);
-	ablkcipher_request_set_tfm(cc->req, cc->tfm);
-	ablkcipher_request_set_callback(cc->req, CRYPTO_TFM_REQ_MAY_BACKLOG |
+	if (!ctx->req)
+		ctx->req = mempool_alloc(cc->req_pool, GFP_NOIO);
+	ablkcipher_request_set_tfm(ctx->req, ctx->set->tfm);
+	ablkcipher_request_set_callback(ctx->req, CRYPTO_TFM_REQ_MAY_BACKLOG |
 					CRYPTO_TFM_REQ_MAY_SLEEP,
 					kcryptd_async_done,
-					dmreq_of_req(cc, cc->req));
+					dmreq_of_req(cc, ctx->req));
 }
 
 /*
@@ -486,7 +606,7 @@ static int crypt_convert(struct crypt_config *cc,
 
 		atomic_inc(&ctx->pending);
 
-		r = crypt_convert_block(cc, ctx, cc->req);
+		r = crypt_convert_block(cc, ctx, ctx->req);
 
 		switch (r) {
 		/* async */
@@ -495,7 +615,7 @@ static int crypt_convert(struct crypt_config *cc,
 			INIT_COMPLETION(ctx->restart);
 			/* fall through*/
 		case -EINPROGRESS:
-			cc->req = NULL;
+			ctx->req = NULL;
 			ctx->sector++;
 			continue;
 
@@ -605,6 +725,7 @@ static struct dm_crypt_io *crypt_io_alloc(struct dm_target *ti,
 	io->sector = sector;
 	io->error = 0;
 	io->base_io = NULL;
+	io->ctx.req = NULL;
 	atomic_set(&io->pending, 0);
 
 	return io;
@@ -630,6 +751,8 @@ static void crypt_dec_pending(struct dm_crypt_io *io)
 	if (!atomic_dec_and_test(&io->pending))
 		return;
 
+	if (io->ctx.req)
+		mempool_free(io->ctx.req, cc->req_pool);
 	mempool_free(io, cc->io_pool);
 
 	if (likely(!base_io))
@@ -654,6 +777,17 @@ static void crypt_dec_pending(struct dm_crypt_io *io)
  * They must be separated as otherwise the final stages could be
  * starved by new requests which can block in the first stages due
  * to memory allocation.
+ *
+ * kcryptd has one thread per CPU and every CPU has its own tfms, so
+ * bios are converted in parallel. Writes are queued on the submitting
+ * CPU, which keeps the writes of one submitter in order on their way
+ * to kcryptd_io. Read completions mostly arrive on the CPU that takes
+ * the disk interrupt, so they are spread over the online CPUs unless
+ * same_cpu_crypt is set.
+ *
+ * With no_read_workqueue, reads completed outside interrupt context
+ * with interrupts enabled (a loop device, for example) are decrypted
+ * directly by the completing thread instead of being handed to kcryptd.
  */
 static void crypt_endio(struct bio *clone, int error)
 {
@@ -673,7 +807,11 @@ static void crypt_endio(struct bio *clone, int error)
 	bio_put(clone);
 
 	if (rw == READ && !error) {
-		kcryptd_queue_crypt(io);
+		if (test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags) &&
+		    !in_interrupt() && !irqs_disabled())
+			kcryptd_crypt_read_inline(io);
+		else
+			kcryptd_queue_crypt(io);
 		return;
 	}
 
@@ -790,6 +928,7 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 	 */
 	crypt_inc_pending(io);
 	crypt_convert_init(cc, &io->ctx, NULL, io->base_bio, sector);
+	io->ctx.set = &this_crypt_config(cc)->set[CRYPT_SET_KCRYPTD];
 
 	/*
 	 * The allocated buffers can be smaller than the whole bio,
@@ -843,6 +982,7 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 			crypt_inc_pending(new_io);
 			crypt_convert_init(cc, &new_io->ctx, NULL,
 					   io->base_bio, sector);
+			new_io->ctx.set = io->ctx.set;
 			new_io->ctx.idx_in = io->ctx.idx_in;
 			new_io->ctx.offset_in = io->ctx.offset_in;
 
@@ -873,7 +1013,8 @@ static void kcryptd_crypt_read_done(struct dm_crypt_io *io, int error)
 	crypt_dec_pending(io);
 }
 
-static void kcryptd_crypt_read_convert(struct dm_crypt_io *io)
+static void kcryptd_crypt_read_convert(struct dm_crypt_io *io,
+				       struct crypt_tfm_set *set)
 {
 	struct crypt_config *cc = io->target->private;
 	int r = 0;
@@ -882,6 +1023,7 @@ static void kcryptd_crypt_read_convert(struct dm_crypt_io *io)
 
 	crypt_convert_init(cc, &io->ctx, io->base_bio, io->base_bio,
 			   io->sector);
+	io->ctx.set = set;
 
 	r = crypt_convert(cc, &io->ctx);
 
@@ -918,19 +1060,59 @@ static void kcryptd_async_done(struct crypto_async_request *async_req,
 static void kcryptd_crypt(struct work_struct *work)
 {
 	struct dm_crypt_io *io = container_of(work, struct dm_crypt_io, work);
+	struct crypt_config *cc = io->target->private;
 
 	if (bio_data_dir(io->base_bio) == READ)
-		kcryptd_crypt_read_convert(io);
+		kcryptd_crypt_read_convert(io,
+				&this_crypt_config(cc)->set[CRYPT_SET_KCRYPTD]);
 	else
 		kcryptd_crypt_write_convert(io);
 }
 
+/*
+ * no_read_workqueue: decrypt a read in the context that completed it.
+ * That context may migrate, so it uses the inline set of the CPU it
+ * started on, under that CPU's inline_lock.
+ */
+static void kcryptd_crypt_read_inline(struct dm_crypt_io *io)
+{
+	struct crypt_config *cc = io->target->private;
+	struct crypt_cpu *cpu_cc = per_cpu_ptr(cc->cpu, raw_smp_processor_id());
+
+	mutex_lock(&cpu_cc->inline_lock);
+	kcryptd_crypt_read_convert(io, &cpu_cc->set[CRYPT_SET_INLINE]);
+	mutex_unlock(&cpu_cc->inline_lock);
+}
+
 static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 {
 	struct crypt_config *cc = io->target->private;
+	unsigned int cpu;
 
 	INIT_WORK(&io->work, kcryptd_crypt);
-	queue_work(cc->crypt_queue, &io->work);
+
+	if (bio_data_dir(io->base_bio) == WRITE ||
+	    test_bit(DM_CRYPT_SAME_CPU, &cc->flags)) {
+		queue_work(cc->crypt_queue, &io->work);
+		return;
+	}
+
+	/*
+	 * Preemption stays off until the work is queued so the chosen
+	 * CPU cannot go offline in between.
+	 */
+	cpu = get_cpu();
+	if (in_interrupt()) {
+		cpu = (unsigned int)atomic_inc_return(&cc->next_cpu) %
+		      nr_cpu_ids;
+		if (!cpu_online(cpu)) {
+			cpu = cpumask_next(cpu, cpu_online_mask);
+			if (cpu >= nr_cpu_ids)
+				cpu = cpumask_first(cpu_online_mask);
+		}
+	}
+	queue_work_on(cpu, cc->crypt_queue, &io->work);
+	put_cpu();
 }
 
 /*
@@ -974,6 +1156,67 @@ static void crypt_encode_key(char *hex, u8 *key, unsigned int size)
 	}
 }
 
+static void crypt_free_tfms(struct crypt_config *cc)
+{
+	struct crypt_tfm_set *set;
+	int cpu, i;
+
+	if (!cc->cpu)
+		return;
+
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < CRYPT_SET_MAX; i++) {
+			set = crypt_cpu_set(cc, cpu, i);
+			if (set->tfm)
+				crypto_free_ablkcipher(set->tfm);
+			set->tfm = NULL;
+		}
+
+	free_percpu(cc->cpu);
+	cc->cpu = NULL;
+}
+
+static int crypt_alloc_tfms(struct crypt_config *cc, char *ciphermode)
+{
+	struct crypto_ablkcipher *tfm;
+	int cpu, i;
+
+	cc->cpu = alloc_percpu(struct crypt_cpu);
+	if (!cc->cpu)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		mutex_init(&per_cpu_ptr(cc->cpu, cpu)->inline_lock);
+
+		for (i = 0; i < crypt_nr_sets(cc); i++) {
+			tfm = crypto_alloc_ablkcipher(ciphermode, 0, 0);
+			if (IS_ERR(tfm)) {
+				crypt_free_tfms(cc);
+				return PTR_ERR(tfm);
+			}
+			crypt_cpu_set(cc, cpu, i)->tfm = tfm;
+		}
+	}
+
+	return 0;
+}
+
+static int crypt_setkey_allcpus(struct crypt_config *cc)
+{
+	int cpu, i, r, err = 0;
+
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < crypt_nr_sets(cc); i++) {
+			r = crypto_ablkcipher_setkey(
+					crypt_cpu_set(cc, cpu, i)->tfm,
+					cc->key, cc->key_size);
+			if (r)
+				err = r;
+		}
+
+	return err;
+}
+
 static int crypt_set_key(struct crypt_config *cc, char *key)
 {
 	unsigned key_size = strlen(key) >> 1;
@@ -989,24 +1232,49 @@ static int crypt_set_key(struct crypt_config *cc, char *key)
 
 	set_bit(DM_CRYPT_KEY_VALID, &cc->flags);
 
-	return crypto_ablkcipher_setkey(cc->tfm, cc->key, cc->key_size);
+	return crypt_setkey_allcpus(cc);
 }
 
 static int crypt_wipe_key(struct crypt_config *cc)
 {
 	clear_bit(DM_CRYPT_KEY_VALID, &cc->flags);
 	memset(&cc->key, 0, cc->key_size * sizeof(u8));
-	return crypto_ablkcipher_setkey(cc->tfm, cc->key, cc->key_size);
+	return crypt_setkey_allcpus(cc);
 }
 
 /*
  * Construct an encryption mapping:
  * <cipher> <key> <iv_offset> <dev_path> <start>
  */
+static int crypt_ctr_optional(struct dm_target *ti, struct crypt_config *cc,
+			      unsigned int argc, char **argv)
+{
+	unsigned long opt_params;
+	unsigned int i;
+
+	if (strict_strtoul(argv[0], 10, &opt_params) ||
+	    opt_params != argc - 1) {
+		ti->error = "Invalid number of feature args";
+		return -EINVAL;
+	}
+
+	for (i = 1; i <= opt_params; i++) {
+		if (!strcasecmp(argv[i], "same_cpu_crypt"))
+			set_bit(DM_CRYPT_SAME_CPU, &cc->flags);
+		else if (!strcasecmp(argv[i], "no_read_workqueue"))
+			set_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
+		else {
+			ti->error = "Invalid feature arguments";
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
 static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 {
 	struct crypt_config *cc;
-	struct crypto_ablkcipher *tfm;
 	char *tmp;
 	char *cipher;
 	char *chainmode;
@@ -1015,7 +1283,7 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	unsigned int key_size;
 	unsigned long long tmpll;
 
-	if (argc != 5) {
+	if (argc < 5) {
 		ti->error = "Not enough arguments";
 		return -EINVAL;
 	}
@@ -1038,6 +1306,10 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		return -ENOMEM;
 	}
 
+	/* Optional parameters, they decide how many tfms are needed */
+	if (argc > 5 && crypt_ctr_optional(ti, cc, argc - 5, &argv[5]))
+		goto bad_cipher;
+
 	/* Compatibility mode for old dm-crypt cipher strings */
 	if (!chainmode || (strcmp(chainmode, "plain") == 0 && !ivmode)) {
 		chainmode = "cbc";
@@ -1055,15 +1327,13 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad_cipher;
 	}
 
-	tfm = crypto_alloc_ablkcipher(cc->cipher, 0, 0);
-	if (IS_ERR(tfm)) {
+	if (crypt_alloc_tfms(cc, cc->cipher) < 0) {
 		ti->error = "Error allocating crypto tfm";
 		goto bad_cipher;
 	}
 
 	strcpy(cc->cipher, cipher);
 	strcpy(cc->chainmode, chainmode);
-	cc->tfm = tfm;
 
 	if (crypt_set_key(cc, argv[1]) < 0) {
 		ti->error = "Error decoding and setting key";
@@ -1102,7 +1372,7 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad_slab_pool;
 	}
 
-	cc->iv_size = crypto_ablkcipher_ivsize(tfm);
+	cc->iv_size = crypto_ablkcipher_ivsize(any_tfm(cc));
 	if (cc->iv_size)
 		/* at least a 64 bit sector number should fit in our buffer */
 		cc->iv_size = max(cc->iv_size,
@@ -1123,9 +1393,9 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	}
 
 	cc->dmreq_start = sizeof(struct ablkcipher_request);
-	cc->dmreq_start += crypto_ablkcipher_reqsize(tfm);
+	cc->dmreq_start += crypto_ablkcipher_reqsize(any_tfm(cc));
 	cc->dmreq_start = ALIGN(cc->dmreq_start, crypto_tfm_ctx_alignment());
-	cc->dmreq_start += crypto_ablkcipher_alignmask(tfm) &
+	cc->dmreq_start += crypto_ablkcipher_alignmask(any_tfm(cc)) &
 			   ~(crypto_tfm_ctx_alignment() - 1);
 
 	cc->req_pool = mempool_create_kmalloc_pool(MIN_IOS, cc->dmreq_start +
@@ -1134,7 +1404,6 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		ti->error = "Cannot allocate crypt request mempool";
 		goto bad_req_pool;
 	}
-	cc->req = NULL;
 
 	cc->page_pool = mempool_create_page_pool(MIN_POOL_PAGES, 0);
 	if (!cc->page_pool) {
@@ -1183,7 +1452,7 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad_io_queue;
 	}
 
-	cc->crypt_queue = create_singlethread_workqueue("kcryptd");
+	cc->crypt_queue = create_workqueue("kcryptd");
 	if (!cc->crypt_queue) {
 		ti->error = "Couldn't create kcryptd queue";
 		goto bad_crypt_queue;
@@ -1211,7 +1480,7 @@ bad_slab_pool:
 	if (cc->iv_gen_ops && cc->iv_gen_ops->dtr)
 		cc->iv_gen_ops->dtr(cc);
 bad_ivmode:
-	crypto_free_ablkcipher(tfm);
+	crypt_free_tfms(cc);
 bad_cipher:
 	/* Must zero key material before freeing */
 	kzfree(cc);
@@ -1225,9 +1494,6 @@ static void crypt_dtr(struct dm_target *ti)
 	destroy_workqueue(cc->io_queue);
 	destroy_workqueue(cc->crypt_queue);
 
-	if (cc->req)
-		mempool_free(cc->req, cc->req_pool);
-
 	bioset_free(cc->bs);
 	mempool_destroy(cc->page_pool);
 	mempool_destroy(cc->req_pool);
@@ -1236,7 +1502,7 @@ static void crypt_dtr(struct dm_target *ti)
 	kfree(cc->iv_mode);
 	if (cc->iv_gen_ops && cc->iv_gen_ops->dtr)
 		cc->iv_gen_ops->dtr(cc);
-	crypto_free_ablkcipher(cc->tfm);
+	crypt_free_tfms(cc);
 	dm_put_device(ti, cc->dev);
 
 	/* Must zero key material before freeing */
@@ -1270,6 +1536,7 @@ static int crypt_status(struct dm_target *ti, status_type_t type,
 {
 	struct crypt_config *cc = (struct crypt_config *) ti->private;
 	unsigned int sz = 0;
+	unsigned int i;
 
 	switch (type) {
 	case STATUSTYPE_INFO:
@@ -1297,6 +1564,16 @@ static int crypt_status(struct dm_target *ti, status_type_t type,
 
 		DMEMIT(" %llu %s %llu", (unsigned long long)cc->iv_offset,
 				cc->dev->name, (unsigned long long)cc->start);
+
+		i = test_bit(DM_CRYPT_SAME_CPU, &cc->flags) +
+		    test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
+		if (i) {
+			DMEMIT(" %u", i);
+			if (test_bit(DM_CRYPT_SAME_CPU, &cc->flags))
+				DMEMIT(" same_cpu_crypt");
+			if (test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags))
+				DMEMIT(" no_read_workqueue");
+		}
 		break;
 	}
 	return 0;
@@ -1393,7 +1670,7 @@ static int crypt_iterate_devices(struct dm_target *ti,
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 7, 0},
+	.version = {1, 8, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
@@ -11,6 +11,7 @@
  */
 #include <linux/if_arp.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/netdevice.h>
 #include "sipc4.h"
 #include "pdp.h"
@@ -383,16 +384,43 @@ static ssize_t pdp_resume_store(struct device *dev,
 	return count;
 }
 
+static ssize_t pdp_rx_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct sipc4_rx_stats stats;
+	u64 ns_per_mb = 0;
+	int count;
+	int i;
+
+	sipc4_get_rx_stats(&stats);
+
+	if (stats.bytes >> 20)
+		ns_per_mb = div64_u64(stats.ns, stats.bytes >> 20);
+
+	count = sprintf(buf, "buffers %lu\nframes %lu\nzerocopy %lu\n"
+			"bytes %llu\nns_per_mb %llu\nbatch",
+			stats.buffers, stats.frames, stats.zerocopy,
+			(unsigned long long)stats.bytes,
+			(unsigned long long)ns_per_mb);
+	for (i = 0; i < SIPC4_RX_BATCH_BINS; i++)
+		count += sprintf(buf + count, " %lu", stats.batch[i]);
+	count += sprintf(buf + count, "\n");
+
+	return count;
+}
+
 static DEVICE_ATTR(activate, 0664, pdp_activate_show, pdp_activate_store);
 static DEVICE_ATTR(deactivate, 0664, NULL, pdp_deactivate_store);
 static DEVICE_ATTR(suspend, 0664, pdp_suspend_show, pdp_suspend_store);
 static DEVICE_ATTR(resume, 0664, NULL, pdp_resume_store);
+static DEVICE_ATTR(rx_stats, 0444, pdp_rx_stats_show, NULL);
 
 static struct attribute *pdp_attrs[] = {
 	&dev_attr_activate.attr,
 	&dev_attr_deactivate.attr,
 	&dev_attr_suspend.attr,
 	&dev_attr_resume.attr,
+	&dev_attr_rx_stats.attr,
 	NULL,
 };
 
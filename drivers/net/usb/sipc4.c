@@ -12,6 +12,7 @@
 
 #include <linux/if_arp.h>
 #include <linux/if_phonet.h>
+#include <linux/ktime.h>
 #include <linux/phonet.h>
 
 #include <net/sock.h>
@@ -26,6 +27,9 @@ static const char hdlc_end[1] = { HDLC_END };
 struct sk_buff_head fmt_multi_list[FMT_MULTI_NR];
 struct rfs_frag rfs_frag_tx;
 
+static struct sipc4_rx_stats rx_stats;
+static DEFINE_SPINLOCK(rx_stats_lock);
+
 static int sipc4_add_hdlc(struct sipc4_tx_data *data, void *header,
 			  int header_size, bool head, bool tail)
 {
@@ -359,7 +363,37 @@ static int sipc4_check_data(struct sipc4_rx_data *data, char *buf, int rest)
 	int alloc_size = data_size;
 	int len;
 	struct sk_buff *skb_new;
+	unsigned long flags;
 	int err;
+	int ch;
+
+	/*
+	 * A whole PDP frame in this page: copy only the headers and hand
+	 * the payload up as a fragment of the rx page.
+	 */
+	ch = sipc4_get_hdlc_ch(hdr->hdr, data->format);
+	if (!skb && data->format == SIPC4_RAW && hdr->len == head_size &&
+	    rest >= data_size &&
+	    data_size > SIPC4_RX_COPYBREAK &&
+	    ch >= CHID_PSD_DATA1 && ch <= CHID_PSD_DATA15) {
+		skb = sipc4_alloc_skb(dev, SIPC4_RX_PULL_LEN);
+		if (unlikely(!skb))
+			return -ENOMEM;
+		memcpy(skb_put(skb, SIPC4_RX_PULL_LEN), buf, SIPC4_RX_PULL_LEN);
+		get_page(data->page);
+		skb_add_rx_frag(skb, 0, data->page,
+				buf + SIPC4_RX_PULL_LEN -
+				(char *)page_address(data->page),
+				data_size - SIPC4_RX_PULL_LEN);
+		data->skb = skb;
+		hdr->flag_len += data_size;
+
+		spin_lock_irqsave(&rx_stats_lock, flags);
+		rx_stats.zerocopy++;
+		spin_unlock_irqrestore(&rx_stats_lock, flags);
+
+		return data_size;
+	}
 
 	if (!skb) {
 		switch (data->format) {
@@ -496,10 +530,40 @@ static int sipc4_hdlc_format_rx(struct sipc4_rx_data *data)
 	return err;
 }
 
+void sipc4_get_rx_stats(struct sipc4_rx_stats *stats)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&rx_stats_lock, flags);
+	*stats = rx_stats;
+	spin_unlock_irqrestore(&rx_stats_lock, flags);
+}
+EXPORT_SYMBOL_GPL(sipc4_get_rx_stats);
+
+static void sipc4_update_rx_stats(int size, int frames, ktime_t start)
+{
+	unsigned long flags;
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	spin_lock_irqsave(&rx_stats_lock, flags);
+	rx_stats.buffers++;
+	rx_stats.frames += frames;
+	rx_stats.bytes += size;
+	rx_stats.ns += ns;
+	rx_stats.batch[sipc_min(fls(frames), SIPC4_RX_BATCH_BINS - 1)]++;
+	spin_unlock_irqrestore(&rx_stats_lock, flags);
+}
+
+/*
+ * One rx buffer may carry many HDLC frames; they are all parsed and handed
+ * up here in one pass, frames split across buffers continue in data->skb.
+ */
 static int sipc4_hdlc_rx(struct sipc4_rx_data *data)
 {
 	int rest = data->size;
 	char *buf = page_address(data->page);
+	ktime_t start = ktime_get();
+	int frames = 0;
 	int len;
 	int err;
 
@@ -540,12 +604,14 @@ next_frame:
 	memset(data->rx_hdr, 0x00, sizeof(struct sipc_rx_hdr));
 
 	data->skb = NULL;
+	frames++;
 
 	if (rest)
 		goto next_frame;
 
 end:
 	netdev_free_page(data->dev, data->page);
+	sipc4_update_rx_stats(data->size, frames, start);
 
 	if (rest < 0)
 		err = -ERANGE;
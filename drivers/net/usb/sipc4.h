@@ -73,6 +73,26 @@ struct sipc4_rx_frag {
 	int			data_len;
 };
 
+/*
+ * RAW frames longer than this are passed up as a fragment of the rx page
+ * instead of being copied, only the first SIPC4_RX_PULL_LEN bytes (IP and
+ * transport headers) go to the linear part of the skb.
+ */
+#define SIPC4_RX_COPYBREAK	256
+#define SIPC4_RX_PULL_LEN	128
+
+#define SIPC4_RX_BATCH_BINS	8
+
+struct sipc4_rx_stats {
+	unsigned long		buffers;	/* HDLC rx buffers parsed */
+	unsigned long		frames;		/* frames delivered */
+	unsigned long		zerocopy;	/* frames delivered as page frags */
+	u64			bytes;		/* rx buffer bytes parsed */
+	u64			ns;		/* time spent parsing them */
+	/* frames per buffer, bin n counts 2^(n-1) .. 2^n - 1 frames */
+	unsigned long		batch[SIPC4_RX_BATCH_BINS];
+};
+
 /* Formatted IPC frame */
 struct fmt_hdr {
 	u16	len;
@@ -143,5 +163,6 @@ struct rfs_frag {
 
 extern int sipc4_tx(struct sipc4_tx_data *tx_data);
 extern int sipc4_rx(struct sipc4_rx_data *rx_data);
+extern void sipc4_get_rx_stats(struct sipc4_rx_stats *stats);
 extern int pdp_netif_rx(struct net_device *parent_ndev, struct sk_buff *skb,
 			int svnet_ch);
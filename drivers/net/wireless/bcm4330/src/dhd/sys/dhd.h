@@ -136,6 +136,14 @@ typedef struct dhd_pub {
 	ulong rx_readahead_cnt;	/* Number of packets where header read-ahead was used. */
 	ulong tx_realloc;	/* Number of tx packets we had to realloc for headroom */
 	ulong fc_packets;       /* Number of flow control pkts recvd */
+#ifdef DHD_RX_NAPI
+#define DHD_NAPI_HIST_BINS	8
+	ulong rx_napi_polls;	/* Number of NAPI poll calls */
+	ulong rx_napi_pkts;	/* Packets delivered through NAPI/GRO */
+	ulong rx_napi_max_batch;	/* Largest batch handled by a single poll */
+	ulong rx_napi_time_us;	/* Time spent in the NAPI poll (softirq) */
+	ulong rx_napi_hist[DHD_NAPI_HIST_BINS];	/* Batch size histogram, log2 bins */
+#endif /* DHD_RX_NAPI */
 
 	/* Last error return */
 	int bcmerror;
@@ -303,7 +311,8 @@ typedef enum dhd_attach_states
 	DHD_ATTACH_STATE_WAKELOCKS_INIT = 0x40,
 	DHD_ATTACH_STATE_CFG80211 = 0x80,
 	DHD_ATTACH_STATE_EARLYSUSPEND_DONE = 0x100,
-	DHD_ATTACH_STATE_DONE = 0x200
+	DHD_ATTACH_STATE_DONE = 0x200,
+	DHD_ATTACH_STATE_RX_NAPI = 0x400
 } dhd_attach_states_t;
 
 /* Value -1 means we are unsuccessful in creating the kthread. */
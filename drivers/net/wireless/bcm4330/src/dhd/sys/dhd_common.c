@@ -204,6 +204,9 @@ static int
 dhd_dump(dhd_pub_t *dhdp, char *buf, int buflen)
 {
 	char eabuf[ETHER_ADDR_STR_LEN];
+#ifdef DHD_RX_NAPI
+	int i;
+#endif
 
 	struct bcmstrbuf b;
 	struct bcmstrbuf *strbuf = &b;
@@ -241,6 +244,15 @@ dhd_dump(dhd_pub_t *dhdp, char *buf, int buflen)
 	            dhdp->rx_ctlpkts, dhdp->rx_ctlerrs, dhdp->rx_dropped);
 	bcm_bprintf(strbuf, "rx_readahead_cnt %ld tx_realloc %ld\n",
 	            dhdp->rx_readahead_cnt, dhdp->tx_realloc);
+#ifdef DHD_RX_NAPI
+	bcm_bprintf(strbuf, "rx_napi_polls %ld rx_napi_pkts %ld rx_napi_max_batch %ld "
+	            "rx_napi_time_us %ld\n", dhdp->rx_napi_polls, dhdp->rx_napi_pkts,
+	            dhdp->rx_napi_max_batch, dhdp->rx_napi_time_us);
+	bcm_bprintf(strbuf, "rx_napi_hist");
+	for (i = 0; i < DHD_NAPI_HIST_BINS; i++)
+		bcm_bprintf(strbuf, " %ld", dhdp->rx_napi_hist[i]);
+	bcm_bprintf(strbuf, "\n");
+#endif /* DHD_RX_NAPI */
 	bcm_bprintf(strbuf, "\n");
 
 	/* Add any prot info */
@@ -363,6 +375,11 @@ dhd_doiovar(dhd_pub_t *dhd_pub, const bcm_iovar_t *vi, uint32 actionid, const ch
 		dhd_pub->rx_readahead_cnt = 0;
 		dhd_pub->tx_realloc = 0;
 		dhd_pub->wd_dpc_sched = 0;
+#ifdef DHD_RX_NAPI
+		dhd_pub->rx_napi_polls = dhd_pub->rx_napi_pkts = 0;
+		dhd_pub->rx_napi_max_batch = dhd_pub->rx_napi_time_us = 0;
+		memset(dhd_pub->rx_napi_hist, 0, sizeof(dhd_pub->rx_napi_hist));
+#endif /* DHD_RX_NAPI */
 		memset(&dhd_pub->dstats, 0, sizeof(dhd_pub->dstats));
 		dhd_bus_clearcounts(dhd_pub);
 		break;
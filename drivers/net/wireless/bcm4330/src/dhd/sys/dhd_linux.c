@@ -334,6 +334,12 @@ typedef struct dhd_info {
 #else
 	bool dhd_tasklet_create;
 #endif /* DHDTHREAD */
+#ifdef DHD_RX_NAPI
+	/* Rx packets are queued by the dpc and handed to GRO from NET_RX_SOFTIRQ */
+	struct net_device rx_napi_dev;
+	struct napi_struct rx_napi;
+	struct sk_buff_head rx_napi_queue;
+#endif /* DHD_RX_NAPI */
 
 	/* Wakelocks */
 #if defined(CONFIG_HAS_WAKELOCK) && (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 27))
@@ -379,6 +385,12 @@ struct semaphore dhd_registration_sem;
 uint dhd_sysioc = TRUE;
 module_param(dhd_sysioc, uint, 0);
 
+#ifdef DHD_RX_NAPI
+/* Max packets delivered per NAPI poll */
+uint dhd_napi_weight = 64;
+module_param(dhd_napi_weight, uint, 0);
+#endif /* DHD_RX_NAPI */
+
 /* Error bits */
 module_param(dhd_msg_level, int, 0);
 
@@ -554,6 +566,11 @@ struct iw_statistics *dhd_get_wireless_stats(struct net_device *dev);
 #endif /* defined(CONFIG_WIRELESS_EXT) */
 
 static void dhd_dpc(ulong data);
+#ifdef DHD_RX_NAPI
+static void dhd_napi_flush_if(dhd_info_t *dhd, struct net_device *net);
+#else
+#define dhd_napi_flush_if(dhd, net)	do { } while (0)
+#endif /* DHD_RX_NAPI */
 /* forward decl */
 extern int dhd_wait_pend8021x(struct net_device *dev);
 
@@ -1054,6 +1071,7 @@ dhd_op_if(dhd_if_t *ifp)
 			DHD_ERROR(("%s: ERROR: netdev:%s already exists, try free & unregister \n",
 			 __FUNCTION__, ifp->net->name));
 			netif_stop_queue(ifp->net);
+			dhd_napi_flush_if(dhd, ifp->net);
 			unregister_netdev(ifp->net);
 			free_netdev(ifp->net);
 		}
@@ -1103,6 +1121,7 @@ dhd_op_if(dhd_if_t *ifp)
 
 	if (ret < 0) {
 		if (ifp->net) {
+			dhd_napi_flush_if(dhd, ifp->net);
 			unregister_netdev(ifp->net);
 			free_netdev(ifp->net);
 		}
@@ -1390,6 +1409,93 @@ static const char *_get_packet_type_str(uint16 type)
 }
 #endif
 
+#ifdef DHD_RX_NAPI
+static int
+dhd_napi_poll(struct napi_struct *napi, int budget)
+{
+	dhd_info_t *dhd = container_of(napi, dhd_info_t, rx_napi);
+	dhd_pub_t *dhdp = &dhd->pub;
+	struct sk_buff *skb;
+	ktime_t start;
+	int work = 0;
+	int bin;
+
+	start = ktime_get();
+
+	while (work < budget && (skb = skb_dequeue(&dhd->rx_napi_queue)) != NULL) {
+		napi_gro_receive(napi, skb);
+		work++;
+	}
+
+	if (work < budget) {
+		napi_complete(napi);
+		/* Catch packets queued after the last dequeue but before completion */
+		if (!skb_queue_empty(&dhd->rx_napi_queue))
+			napi_schedule(napi);
+	}
+
+	dhdp->rx_napi_polls++;
+	dhdp->rx_napi_pkts += work;
+	if (work > dhdp->rx_napi_max_batch)
+		dhdp->rx_napi_max_batch = work;
+	bin = MIN(fls(work), DHD_NAPI_HIST_BINS - 1);
+	dhdp->rx_napi_hist[bin]++;
+	dhdp->rx_napi_time_us += (ulong)ktime_to_us(ktime_sub(ktime_get(), start));
+
+	return work;
+}
+
+static void
+dhd_napi_init(dhd_info_t *dhd)
+{
+	skb_queue_head_init(&dhd->rx_napi_queue);
+	init_dummy_netdev(&dhd->rx_napi_dev);
+	netif_napi_add(&dhd->rx_napi_dev, &dhd->rx_napi, dhd_napi_poll,
+	               dhd_napi_weight ? dhd_napi_weight : 64);
+	napi_enable(&dhd->rx_napi);
+}
+
+static void
+dhd_napi_deinit(dhd_info_t *dhd)
+{
+	napi_disable(&dhd->rx_napi);
+	netif_napi_del(&dhd->rx_napi);
+	skb_queue_purge(&dhd->rx_napi_queue);
+}
+
+/* Drop queued rx packets for an interface that is about to be unregistered */
+static void
+dhd_napi_flush_if(dhd_info_t *dhd, struct net_device *net)
+{
+	struct sk_buff *skb, *tmp;
+	unsigned long flags;
+
+	if (!(dhd->dhd_state & DHD_ATTACH_STATE_RX_NAPI))
+		return;
+
+	/* Wait for a running poll so no packet for net is in flight */
+	napi_disable(&dhd->rx_napi);
+
+	spin_lock_irqsave(&dhd->rx_napi_queue.lock, flags);
+	skb_queue_walk_safe(&dhd->rx_napi_queue, skb, tmp) {
+		if (skb->dev == net) {
+			__skb_unlink(skb, &dhd->rx_napi_queue);
+			dev_kfree_skb_any(skb);
+		}
+	}
+	spin_unlock_irqrestore(&dhd->rx_napi_queue.lock, flags);
+
+	napi_enable(&dhd->rx_napi);
+
+	/* Packets for the other interfaces were not polled while disabled */
+	if (!skb_queue_empty(&dhd->rx_napi_queue)) {
+		local_bh_disable();
+		napi_schedule(&dhd->rx_napi);
+		local_bh_enable();
+	}
+}
+#endif /* DHD_RX_NAPI */
+
 void
 dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 {
@@ -1531,6 +1637,10 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 		dhdp->dstats.rx_bytes += skb->len;
 		dhdp->rx_packets++; /* Local count */
 
+#ifdef DHD_RX_NAPI
+		/* Batch the chain and let the poll hand it to GRO */
+		skb_queue_tail(&dhd->rx_napi_queue, skb);
+#else
 		if (in_interrupt()) {
 			netif_rx(skb);
 		} else {
@@ -1550,7 +1660,21 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 			local_irq_restore(flags);
 #endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0) */
 		}
+#endif /* DHD_RX_NAPI */
 	}
+
+#ifdef DHD_RX_NAPI
+	if (!skb_queue_empty(&dhd->rx_napi_queue)) {
+		if (in_interrupt()) {
+			napi_schedule(&dhd->rx_napi);
+		} else {
+			/* local_bh_enable() runs the NET_RX_SOFTIRQ we just raised */
+			local_bh_disable();
+			napi_schedule(&dhd->rx_napi);
+			local_bh_enable();
+		}
+	}
+#endif /* DHD_RX_NAPI */
 	DHD_OS_WAKE_LOCK_TIMEOUT_ENABLE(dhdp);
 }
 
@@ -2310,6 +2434,7 @@ dhd_add_if(dhd_info_t *dhd, int ifidx, void *handle, char *name,
 	if (ifp != NULL) {
 		if (ifp->net != NULL) {
 			netif_stop_queue(ifp->net);
+			dhd_napi_flush_if(dhd, ifp->net);
 			unregister_netdev(ifp->net);
 			free_netdev(ifp->net);
 		}
@@ -2506,6 +2631,11 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 	}
 	dhd_state |= DHD_ATTACH_STATE_CFG80211;
 #endif
+#ifdef DHD_RX_NAPI
+	dhd_napi_init(dhd);
+	dhd_state |= DHD_ATTACH_STATE_RX_NAPI;
+#endif /* DHD_RX_NAPI */
+
 	/* Set up the watchdog timer */
 	init_timer(&dhd->timer);
 	dhd->timer.data = (ulong)dhd;
@@ -2852,6 +2982,9 @@ dhd_net_attach(dhd_pub_t *dhdp, int ifidx)
 		}
 	}
 	net->hard_header_len = ETH_HLEN + dhd->pub.hdrlen;
+#ifdef DHD_RX_NAPI
+	net->features |= NETIF_F_GRO;
+#endif /* DHD_RX_NAPI */
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 24)
 	net->ethtool_ops = &dhd_ethtool_ops;
 #endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 24) */
@@ -3027,6 +3160,12 @@ dhd_detach(dhd_pub_t *dhdp)
 		}
 	}
 
+#ifdef DHD_RX_NAPI
+	/* The dpc is gone, nothing can queue rx packets any more */
+	if (dhd->dhd_state & DHD_ATTACH_STATE_RX_NAPI)
+		dhd_napi_deinit(dhd);
+#endif /* DHD_RX_NAPI */
+
 	if (dhd->dhd_state & DHD_ATTACH_STATE_ADD_IF) {
 		dhd_if_t *ifp;
 		ifp = dhd->iflist[0];
@@ -28,6 +28,11 @@ unsigned int j4fs_PORCount=0;
 unsigned int j4fs_rw_start=0;
 j4fs_header ro_j4fs_header[J4FS_MAX_RO_FILES_NUMBER];
 int ro_j4fs_header_count=0;
+j4fs_header j4fs_header_index[J4FS_MAX_FILE_NUM];
+int j4fs_header_index_count=0;
+int j4fs_header_index_valid=0;
+static j4fs_header j4fs_header_index_pending;
+static DWORD j4fs_header_index_pending_offset=0xffffffff;
 int j4fs_panic=0;
 
 #ifdef J4FS_TRANSACTION_LOGGING
@@ -122,6 +127,41 @@ int fsd_read(j4fs_ctrl *ctl)
 		goto error1;
 	}
 
+	// find object header corresponding to ctl.id in the in-memory copy of the RW j4fs_header list
+	if(j4fs_header_index_valid)
+	{
+		for(i=0;i<j4fs_header_index_count;i++)
+		{
+			offset=fsd_header_index_offset(i);
+			header=&j4fs_header_index[i];
+
+			// RO area was handled above
+			if(offset<j4fs_rw_start) continue;
+
+			// This file was deleted, so check next j4fs_header.
+			if((header->flags&0x1)!=((header->flags&0x2)>>1)) continue;
+
+			// File ID is dismatched, so check next file.
+			if(ctl->id && ctl->id!=header->id) continue;
+
+			// File ID is matched. we should read lastest object larger than ctl.index, so go ahead.
+			#ifdef __KERNEL__
+			if( ((ctl->index + ctl->count + PAGE_SIZE-1)/PAGE_SIZE*PAGE_SIZE)
+				<= ((header->length + PAGE_SIZE-1)/PAGE_SIZE*PAGE_SIZE) )
+			#else
+			if( ((ctl->index + ctl->count + J4FS_BASIC_UNIT_SIZE-1)/J4FS_BASIC_UNIT_SIZE*J4FS_BASIC_UNIT_SIZE)
+				<= ((header->length + J4FS_BASIC_UNIT_SIZE-1)/J4FS_BASIC_UNIT_SIZE*J4FS_BASIC_UNIT_SIZE) )
+			#endif
+			{
+				matching_offset=offset;
+				file_length=header->length;
+			}
+			else file_exist=1;
+		}
+
+		goto got_header;
+	}
+
 	// the start address of the RW area of the device (partition)
 	offset=j4fs_rw_start;
 
@@ -200,23 +240,7 @@ got_header:
 		if(len>file_length) len=file_length;
 		count=0;
 
-		// read data per page size
-		while(len>=device_info.pagesize)
-		{
-			T(J4FS_TRACE_FSD,("%s %d: (offset,count,len)=(0x%08x,%d,%d)\n",__FUNCTION__,__LINE__,matching_offset,count,len));
-
-			ret = FlashDevRead(&device_info, matching_offset, device_info.pagesize, ctl->buffer+count);
-
-			if (error(ret)) {
-				T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%08x)\n",__FUNCTION__,__LINE__,ret));
-				goto error1;
-			}
-			count+=device_info.pagesize;
-			matching_offset+=device_info.pagesize;
-			len-=device_info.pagesize;
-		}
-
-		// read data less than one page and larger than sector
+		// read all whole sectors in one request. File data is contiguous on the device.
 		if(len>=512)
 		{
 			T(J4FS_TRACE_FSD,("%s %d: (offset,count,len)=(0x%08x,%d,%d)\n",__FUNCTION__,__LINE__,matching_offset,count,len));
@@ -555,6 +579,7 @@ int fsd_write(j4fs_ctrl *ctl)
 				T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%08x)\n",__FUNCTION__,__LINE__,ret));
 				goto error1;
 			}
+			fsd_update_header_index(matching_latest_offset, header);
 
 			goto done;
 		}
@@ -709,6 +734,7 @@ int fsd_write(j4fs_ctrl *ctl)
 					T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%08x)\n",__FUNCTION__,__LINE__,ret));
 					goto error1;
 				}
+				fsd_update_header_index(matching_latest_offset, header);
 			}
 			goto done;
 		}
@@ -921,6 +947,7 @@ int fsd_write(j4fs_ctrl *ctl)
 				T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%08x)\n",__FUNCTION__,__LINE__,ret));
 				goto error1;
 			}
+			fsd_update_header_index(new_header_offset, header);
 
 			// update the link of last_object_offset to indicate new_header_offset
 			// read j4fs_header
@@ -960,6 +987,7 @@ int fsd_write(j4fs_ctrl *ctl)
 				T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%08x)\n",__FUNCTION__,__LINE__,ret));
 				goto error1;
 			}
+			fsd_update_header_index(last_object_offset, header);
 
 			// write new data(file size is extended)
 			buffer_index=0;
@@ -1099,6 +1127,7 @@ int fsd_write(j4fs_ctrl *ctl)
 				T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%08x)\n",__FUNCTION__,__LINE__,ret));
 				goto error1;
 			}
+			fsd_update_header_index(new_header_offset, header);
 
 			goto done;
 		}
@@ -1219,6 +1248,7 @@ int fsd_unlink(char *filename)
 			T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%08x)\n",__FUNCTION__,__LINE__,ret));
 	   		goto error1;
 		}
+		fsd_update_header_index(offset, header);
 
 		offset=header->link;
 	}
@@ -1278,6 +1308,9 @@ int fsd_reclaim()
 	header=(j4fs_header *)buf_header;
 	mst=(j4fs_mst *)buf_mst;
 
+	// reclaim moves j4fs_headers around, so j4fs_header_index must be read again afterwards
+	j4fs_header_index_valid=0;
+
 	// read mst
 	ret = FlashDevRead(&device_info, 0, J4FS_BASIC_UNIT_SIZE, buf_mst);
 	if (error(ret)) {
@@ -1866,6 +1899,150 @@ error1:
 
 }
 
+// offset of i-th j4fs_header in j4fs_header_index
+DWORD fsd_header_index_offset(int i)
+{
+	return (i>0)?j4fs_header_index[i-1].link:device_info.j4fs_offset;
+}
+
+static void fsd_header_index_append(DWORD offset, j4fs_header *header)
+{
+	// the chain on flash must continue at offset, otherwise the index no longer matches it
+	if(offset!=(j4fs_header_index_count ? j4fs_header_index[j4fs_header_index_count-1].link : device_info.j4fs_offset) ||
+		j4fs_header_index_count>=J4FS_MAX_FILE_NUM)
+	{
+		j4fs_header_index_valid=0;
+		return;
+	}
+
+	memcpy(j4fs_header_index+j4fs_header_index_count, header, sizeof(j4fs_header));
+	j4fs_header_index_count++;
+}
+
+/*
+  * Update j4fs_header_index after the j4fs_header at offset was written, instead of reading the whole list again.
+  * A new object's header is written before the link of the previous last header points to it, so it is kept aside
+  * until that link is written. Anything else invalidates the index; the next fsd_build_header_index() rescans the flash.
+  * Called with the lock held for writing.
+  */
+void fsd_update_header_index(DWORD offset, j4fs_header *header)
+{
+	int i;
+
+	if(!j4fs_header_index_valid) return;
+
+	for(i=0;i<j4fs_header_index_count;i++)
+	{
+		if(fsd_header_index_offset(i)!=offset) continue;
+
+		memcpy(j4fs_header_index+i, header, sizeof(j4fs_header));
+
+		// the last j4fs_header now links to the new object written before
+		if(i==j4fs_header_index_count-1 && header->link!=0xffffffff)
+		{
+			if(header->link==j4fs_header_index_pending_offset)
+				fsd_header_index_append(j4fs_header_index_pending_offset, &j4fs_header_index_pending);
+			else
+				j4fs_header_index_valid=0;
+			j4fs_header_index_pending_offset=0xffffffff;
+		}
+		return;
+	}
+
+	// the first j4fs_header of an empty list
+	if(!j4fs_header_index_count)
+	{
+		fsd_header_index_append(offset, header);
+		return;
+	}
+
+	// a new object that is not linked yet
+	if(header->link==0xffffffff)
+	{
+		memcpy(&j4fs_header_index_pending, header, sizeof(j4fs_header));
+		j4fs_header_index_pending_offset=offset;
+		return;
+	}
+
+	j4fs_header_index_valid=0;
+}
+
+/*
+  * Read the whole j4fs_header list (RO and RW area) into j4fs_header_index so that lookups, readdir and fsd_read don't have to
+  * walk the list on flash. This should be called after mount and whenever fsd_update_header_index() or a reclaim invalidated it, with the lock held for writing.
+  * If the list can't be read or is too long, j4fs_header_index_valid stays 0 and callers fall back to scanning the flash.
+  */
+int fsd_build_header_index(void)
+{
+	DWORD offset;
+	j4fs_header *header;
+	int ret=-1;
+
+#ifdef __KERNEL__
+	BYTE *buf;
+#else
+	BYTE buf[J4FS_BASIC_UNIT_SIZE];
+#endif
+
+	// invalidate first, so that readers fall back to the flash even if we fail below
+	j4fs_header_index_valid=0;
+	j4fs_header_index_count=0;
+	j4fs_header_index_pending_offset=0xffffffff;
+
+#ifdef __KERNEL__
+	buf=kmalloc(J4FS_BASIC_UNIT_SIZE,GFP_NOFS);
+	if(!buf) return J4FS_FAIL;
+#endif
+
+	// the start address of the device (partition)
+	offset=device_info.j4fs_offset;
+
+	while(offset!=0xffffffff)
+	{
+		if(offset + J4FS_BASIC_UNIT_SIZE > device_info.j4fs_end)
+		{
+			T(J4FS_TRACE_ALWAYS,("%s %d: offset overflow(offset=0x%08x, j4fs_end=0x%08x)\n",__FUNCTION__,__LINE__,offset,device_info.j4fs_end));
+			goto error1;
+		}
+
+		// read j4fs_header
+		ret = FlashDevRead(&device_info, offset, J4FS_BASIC_UNIT_SIZE, buf);
+		if (error(ret)) {
+			T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%08x)\n",__FUNCTION__,__LINE__,ret));
+			goto error1;
+		}
+		header=(j4fs_header *)buf;
+
+		// This j4fs_header cannot be interpreted. Leave the crash handling to the flash scanning path.
+		if(header->type!=J4FS_FILE_TYPE) goto error1;
+
+		if(j4fs_header_index_count>=J4FS_MAX_FILE_NUM)
+		{
+			T(J4FS_TRACE_ALWAYS,("%s %d: Too many j4fs_headers to index, scanning flash instead\n",__FUNCTION__,__LINE__));
+			goto error1;
+		}
+
+		memcpy(j4fs_header_index+j4fs_header_index_count, header, sizeof(j4fs_header));
+		j4fs_header_index_count++;
+
+		offset=header->link;
+	}
+
+	j4fs_header_index_valid=1;
+
+#ifdef __KERNEL__
+	kfree(buf);
+#endif
+	return J4FS_SUCCESS;
+
+error1:
+	j4fs_header_index_count=0;
+#ifdef __KERNEL__
+	kfree(buf);
+#endif
+	return J4FS_FAIL;
+}
+
 #ifdef J4FS_TRANSACTION_LOGGING
 int fsd_initialize_transaction()
 {
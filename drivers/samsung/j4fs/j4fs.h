@@ -22,6 +22,7 @@
 #include <linux/types.h>
 #include <asm/types.h>
 #include <linux/spinlock.h>
+#include <linux/rwsem.h>
 #include <linux/fs.h>
 #include <linux/mount.h>
 #include <linux/buffer_head.h>
@@ -103,6 +104,11 @@
  */
 #define J4FS_NAME_LEN 128
 
+/*
+ * Max pages read from the device in one request by readpages
+ */
+#define J4FS_READPAGES_BATCH	16
+
 /*
  * Max RO file number
  */
@@ -364,7 +370,7 @@ typedef struct {
 	DWORD aux;
 
 #ifdef __KERNEL__
-	struct semaphore grossLock;	/* Gross locking semaphore */
+	struct rw_semaphore grossLock;	/* Readers share it, anything that writes the device takes it exclusively */
 #endif
 } j4fs_device_info;
 
@@ -439,6 +445,7 @@ extern int j4fs_permission(struct inode *inode, int mask, struct nameidata *nd);
 #endif
 
 extern int j4fs_readpage_unlock(struct file *f, struct page *page);
+extern int j4fs_readpages(struct file *filp, struct address_space *mapping, struct list_head *pages, unsigned nr_pages);
 extern int j4fs_readpage_nolock(struct file *f, struct page *page);
 extern int j4fs_file_write(struct file *f, const char *buf, size_t n,loff_t *pos);
 extern int j4fs_hold_space(int size);
@@ -470,6 +477,9 @@ extern int fsd_delete(j4fs_ctrl *);
 extern int fsd_special(j4fs_ctrl *);
 extern int fsd_print_meta_data(void);
 extern int fsd_read_ro_header(void);
+extern int fsd_build_header_index(void);
+extern void fsd_update_header_index(DWORD offset, j4fs_header *header);
+extern DWORD fsd_header_index_offset(int i);
 extern int fsd_mark_invalid(void);
 extern int fsd_reclaim(void);
 extern int fsd_panic(void);
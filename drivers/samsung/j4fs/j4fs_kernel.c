@@ -60,18 +60,39 @@ extern int ro_j4fs_header_count;
 extern unsigned int j4fs_next_sequence;
 extern unsigned int j4fs_transaction_next_offset;
 extern int j4fs_panic;
+extern j4fs_header j4fs_header_index[];
+extern int j4fs_header_index_count;
+extern int j4fs_header_index_valid;
 
+/*
+ * The j4fs_header list is a single chain on the device, so anything that writes the device
+ * takes the lock exclusively. Reads, lookups and readdir only take it shared and run in parallel.
+ * Writers to one file are already serialized by i_mutex.
+ */
 void j4fs_GrossLock(void)
 {
 	T(J4FS_TRACE_LOCK, ("j4fs locking %p\n", current));
-	down(&device_info.grossLock);
+	down_write(&device_info.grossLock);
 	T(J4FS_TRACE_LOCK, ("j4fs locked %p\n", current));
 }
 
 void j4fs_GrossUnlock(void)
 {
 	T(J4FS_TRACE_LOCK, ("j4fs unlocking %p\n", current));
-	up(&device_info.grossLock);
+	up_write(&device_info.grossLock);
+}
+
+void j4fs_ReadLock(void)
+{
+	T(J4FS_TRACE_LOCK, ("j4fs read locking %p\n", current));
+	down_read(&device_info.grossLock);
+	T(J4FS_TRACE_LOCK, ("j4fs read locked %p\n", current));
+}
+
+void j4fs_ReadUnlock(void)
+{
+	T(J4FS_TRACE_LOCK, ("j4fs read unlocking %p\n", current));
+	up_read(&device_info.grossLock);
 }
 
 int j4fs_readpage(struct file *f, struct page *page)
@@ -109,7 +130,7 @@ int j4fs_readpage_nolock(struct file *f, struct page *page)
 	page_buf = kmap(page);
 	/* FIXME: Can kmap fail? */
 
-	j4fs_GrossLock();
+	j4fs_ReadLock();
 
 	ctl.buffer=page_buf;
 	ctl.count=PAGE_CACHE_SIZE;
@@ -117,7 +138,7 @@ int j4fs_readpage_nolock(struct file *f, struct page *page)
 	ctl.index=page->index << PAGE_CACHE_SHIFT;
 	ret=fsd_read(&ctl);
 
-	j4fs_GrossUnlock();
+	j4fs_ReadUnlock();
 
 	if (ret >= 0)
 		ret = 0;
@@ -136,6 +157,93 @@ int j4fs_readpage_nolock(struct file *f, struct page *page)
 	return ret;
 }
 
+/*
+ * Read a run of pages with consecutive indexes with one fsd_read and copy them into the page cache.
+ * File data is contiguous on the device, so this is a single device read.
+ */
+static void j4fs_readpages_batch(struct inode *inode, struct page **pages, int nr, BYTE *buf)
+{
+	j4fs_ctrl ctl;
+	char *page_buf;
+	int ret, i;
+
+	T(J4FS_TRACE_FS_READ,("%s %d: (ino,index,nr)=(%lu,%lu,%d)\n",__FUNCTION__,__LINE__,inode->i_ino,pages[0]->index,nr));
+
+	j4fs_ReadLock();
+
+	ctl.buffer=buf;
+	ctl.count=nr*PAGE_CACHE_SIZE;
+	ctl.id=inode->i_ino;
+	ctl.index=pages[0]->index << PAGE_CACHE_SHIFT;
+	ret=fsd_read(&ctl);
+
+	j4fs_ReadUnlock();
+
+	// fsd_read returns the number of bytes read for a valid file. The tail past EOF is zero.
+	if(ret>=0 && ret<ctl.count && !error(ret))
+		memset(buf+ret, 0, ctl.count-ret);
+
+	for(i=0;i<nr;i++)
+	{
+		if(error(ret)) {
+			ClearPageUptodate(pages[i]);
+			SetPageError(pages[i]);
+		} else {
+			page_buf=kmap(pages[i]);
+			memcpy(page_buf, buf+i*PAGE_CACHE_SIZE, PAGE_CACHE_SIZE);
+			flush_dcache_page(pages[i]);
+			kunmap(pages[i]);
+			SetPageUptodate(pages[i]);
+			ClearPageError(pages[i]);
+		}
+		unlock_page(pages[i]);
+		page_cache_release(pages[i]);
+	}
+}
+
+int j4fs_readpages(struct file *filp, struct address_space *mapping, struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode=mapping->host;
+	struct page *batch[J4FS_READPAGES_BATCH];
+	struct page *page;
+	BYTE *buf;
+	unsigned i;
+	int nr=0;
+
+	T(J4FS_TRACE_FS_READ,("%s %d: nr_pages=%u\n",__FUNCTION__,__LINE__,nr_pages));
+
+	buf=kmalloc(J4FS_READPAGES_BATCH*PAGE_CACHE_SIZE,GFP_NOFS);
+
+	for(i=0;i<nr_pages;i++)
+	{
+		page=list_entry(pages->prev, struct page, lru);
+		list_del(&page->lru);
+
+		if(add_to_page_cache_lru(page, mapping, page->index, GFP_KERNEL)) {
+			page_cache_release(page);
+			continue;
+		}
+
+		// no bounce buffer, read page by page
+		if(!buf) {
+			j4fs_readpage_unlock(filp, page);
+			page_cache_release(page);
+			continue;
+		}
+
+		if(nr && (nr==J4FS_READPAGES_BATCH || batch[nr-1]->index+1!=page->index)) {
+			j4fs_readpages_batch(inode, batch, nr, buf);
+			nr=0;
+		}
+		batch[nr++]=page;
+	}
+
+	if(nr) j4fs_readpages_batch(inode, batch, nr, buf);
+
+	kfree(buf);
+	return 0;
+}
+
 int j4fs_writepage(struct page *page, struct writeback_control *wbc)
 {
 	struct address_space *mapping = page->mapping;
@@ -199,6 +307,9 @@ int j4fs_writepage(struct page *page, struct writeback_control *wbc)
 
 	if(nErr==J4FS_RETRY_WRITE) nErr=fsd_write(&ctl);
 
+	// j4fs_header_index is updated in place; only a reclaim or an unexpected header makes us read it again
+	if(!j4fs_header_index_valid) fsd_build_header_index();
+
 	T(J4FS_TRACE_FS,
 		("j4fs_writepage: index=%08x,nBytes=%08x,inode.i_size=%05x\n", (unsigned)(page->index << PAGE_CACHE_SHIFT), nBytes,(int)inode->i_size));
 
@@ -429,6 +540,9 @@ int j4fs_file_write(struct file *f, const char *buf, size_t n, loff_t *pos)
 
 	if(nWritten==J4FS_RETRY_WRITE) nWritten=fsd_write(&ctl);
 
+	// j4fs_header_index is updated in place; only a reclaim or an unexpected header makes us read it again
+	if(!j4fs_header_index_valid) fsd_build_header_index();
+
 	if(nWritten==J4FS_RETRY_WRITE || error(nWritten))
 	{
 		T(J4FS_TRACE_ALWAYS,("%s %d: Error(nWritten=0x%x)\n",__FUNCTION__,__LINE__,nWritten));
@@ -453,7 +567,8 @@ struct j4fs_inode *j4fs_get_inode(struct super_block *sb, ino_t ino)
 {
 	unsigned int cur_link, latest_matching_offset=0xffffffff;
 	struct j4fs_inode *raw_inode;
-	int nErr;
+	j4fs_header *header;
+	int nErr, i;
 	BYTE *buf;
 
 	T(J4FS_TRACE_FS,("%s %d\n",__FUNCTION__,__LINE__));
@@ -469,6 +584,21 @@ struct j4fs_inode *j4fs_get_inode(struct super_block *sb, ino_t ino)
 
 	if(ino==J4FS_ROOT_INO) goto error1;
 
+	// find latest j4fs_header which inode number is ino in the in-memory copy
+	if(j4fs_header_index_valid)
+	{
+		for(i=j4fs_header_index_count-1;i>=0;i--)
+		{
+			header=&j4fs_header_index[i];
+			if(((header->flags&0x1)==((header->flags&0x2)>>1)) && header->id==ino)
+			{
+				memcpy(buf, header, sizeof(j4fs_header));
+				return (struct j4fs_inode *)buf;
+			}
+		}
+		goto Einval;
+	}
+
 	// read j4fs_header in flash which inode number is ino
 	cur_link=device_info.j4fs_offset;
 	while(cur_link!=0xffffffff)
@@ -571,7 +701,9 @@ void j4fs_read_inode (struct inode * inode)
 		return;
 	}
 
+	j4fs_ReadLock();
 	raw_inode = j4fs_get_inode(inode->i_sb, ino);
+	j4fs_ReadUnlock();
 
 	if (IS_ERR(raw_inode))
  		goto bad_inode;
@@ -613,8 +745,8 @@ ino_t j4fs_inode_by_name(struct inode * dir, struct dentry *dentry)
 	unsigned int cur_link;
 	struct j4fs_inode_info *ei = J4FS_I(dir);
 	struct j4fs_inode *raw_inode;
-	ino_t ino;
-	int nErr;
+	ino_t ino=0;
+	int nErr, i;
 	BYTE *buf;
 
 	if(j4fs_panic==1) {
@@ -624,6 +756,25 @@ ino_t j4fs_inode_by_name(struct inode * dir, struct dentry *dentry)
 
 	T(J4FS_TRACE_FS,("%s %d\n",__FUNCTION__,__LINE__));
 
+	j4fs_ReadLock();
+
+	// look the name up in the in-memory copy of the j4fs_header list
+	if(j4fs_header_index_valid)
+	{
+		for(i=0;i<j4fs_header_index_count;i++)
+		{
+			raw_inode=(struct j4fs_inode *)&j4fs_header_index[i];
+			if(((raw_inode->i_flags&0x1)==((raw_inode->i_flags&0x2)>>1)) &&
+				!strcmp(raw_inode->i_filename, dentry->d_name.name))
+			{
+				ino=raw_inode->i_id;
+				break;
+			}
+		}
+		j4fs_ReadUnlock();
+		return ino;
+	}
+
 	buf=kmalloc(J4FS_BASIC_UNIT_SIZE,GFP_NOFS);
 
 	cur_link=ei->i_link;
@@ -661,6 +812,7 @@ ino_t j4fs_inode_by_name(struct inode * dir, struct dentry *dentry)
 			{
 				ino = raw_inode->i_id;
 				kfree(buf);
+				j4fs_ReadUnlock();
 				return ino;
 			}
 		}
@@ -670,6 +822,7 @@ ino_t j4fs_inode_by_name(struct inode * dir, struct dentry *dentry)
 
 error1:
 	kfree(buf);
+	j4fs_ReadUnlock();
 
 	return 0;
 
@@ -695,7 +848,7 @@ int j4fs_readdir (struct file * filp, void * dirent, filldir_t filldir)
 
 	buf=kmalloc(J4FS_BASIC_UNIT_SIZE,GFP_NOFS);
 
-	j4fs_GrossLock();
+	j4fs_ReadLock();
 
 	offset = filp->f_pos;
 
@@ -721,6 +874,42 @@ int j4fs_readdir (struct file * filp, void * dirent, filldir_t filldir)
 
 	curoffs = 1;
 
+	// Add files(latest valid object) to directory entry from the in-memory copy of the j4fs_header list
+	if(j4fs_header_index_valid)
+	{
+		for(i=0;i<j4fs_header_index_count;i++)
+		{
+			raw_inode=(struct j4fs_inode *)&j4fs_header_index[i];
+
+			// check whether this file was deleted
+			if ((raw_inode->i_flags&0x1)!=((raw_inode->i_flags&0x2)>>1)) continue;
+
+			// If there is a later valid object with same inode number, this one is invalid
+			for(j=i+1;j<j4fs_header_index_count;j++)
+			{
+				if (((j4fs_header_index[j].flags&0x1)==((j4fs_header_index[j].flags&0x2)>>1)) &&
+					j4fs_header_index[j].id==raw_inode->i_id) break;
+			}
+			if(j<j4fs_header_index_count) continue;
+
+			curoffs++;
+			if(curoffs >= offset)
+			{
+				nErr=filldir(dirent, raw_inode->i_filename, strlen(raw_inode->i_filename), offset, raw_inode->i_id, DT_REG);
+
+				if(nErr <0) {
+					T(J4FS_TRACE_ALWAYS,("%s %d: error(nErr=0x%08x,filename=%s, file length=%d)\n",__FUNCTION__,__LINE__,nErr,raw_inode->i_filename, strlen(raw_inode->i_filename)));
+					goto error1;
+				}
+
+				T(J4FS_TRACE_FS,("%s %d: success(filename=%s, file length=%d)\n",__FUNCTION__,__LINE__,raw_inode->i_filename, strlen(raw_inode->i_filename)));
+				offset++;
+				filp->f_pos++;
+			}
+		}
+		goto error1;
+	}
+
 	cur_link=ei->i_link;
 	while(cur_link!=0xffffffff)
 	{
@@ -801,7 +990,7 @@ int j4fs_readdir (struct file * filp, void * dirent, filldir_t filldir)
 
 error1:
 	kfree(buf);
-	j4fs_GrossUnlock();
+	j4fs_ReadUnlock();
 	return 0;
 }
 
@@ -866,7 +1055,7 @@ struct inode *j4fs_new_inode(struct inode *dir, struct dentry *dentry, int mode)
 	unsigned int offset, last_object_offset=0xffffffff, new_object_offset=0xffffffff;
 	struct j4fs_inode *raw_inode=0;
 	ino_t ino = J4FS_FIRST_INO-1;
-	int nErr;
+	int nErr, i;
 	BYTE *buf;
 
 #ifdef J4FS_TRANSACTION_LOGGING
@@ -903,6 +1092,23 @@ struct inode *j4fs_new_inode(struct inode *dir, struct dentry *dentry, int mode)
 		goto error1;
 	}
 
+	// find existing largest inode number and the last object from the in-memory copy of the j4fs_header list
+	if(j4fs_header_index_valid && j4fs_header_index_count)
+	{
+		for(i=0;i<j4fs_header_index_count;i++)
+		{
+			raw_inode=(struct j4fs_inode *)&j4fs_header_index[i];
+			if ((raw_inode->i_flags&0x1)==((raw_inode->i_flags&0x2)>>1)) {
+				if(raw_inode->i_id>ino) ino=raw_inode->i_id;
+			}
+		}
+
+		last_object_offset=fsd_header_index_offset(j4fs_header_index_count-1);
+		memcpy(buf, &j4fs_header_index[j4fs_header_index_count-1], sizeof(j4fs_header));
+		raw_inode=(struct j4fs_inode *)buf;
+		goto got_last_object;
+	}
+
 	// find existing largest inode number
 	// TODO: 1. RO files --> use ro_j4fs_header buffer
 	offset=device_info.j4fs_offset;
@@ -944,6 +1150,7 @@ struct inode *j4fs_new_inode(struct inode *dir, struct dentry *dentry, int mode)
 		offset=raw_inode->i_link;
 	}
 
+got_last_object:
 	// set inode number
 	ino++;
 
@@ -1023,6 +1230,7 @@ struct inode *j4fs_new_inode(struct inode *dir, struct dentry *dentry, int mode)
 		T(J4FS_TRACE_ALWAYS,("%s %d: error(nErr=0x%x)\n",__FUNCTION__,__LINE__,nErr));
    		goto error1;
 	}
+	fsd_update_header_index(new_object_offset, (j4fs_header *)buf);
 
 	// update last_inode
 	if(last_object_offset!=0xffffffff)
@@ -1068,6 +1276,7 @@ struct inode *j4fs_new_inode(struct inode *dir, struct dentry *dentry, int mode)
 			T(J4FS_TRACE_ALWAYS,("%s %d: error(nErr=0x%x)\n",__FUNCTION__,__LINE__,nErr));
 	   		goto error1;
 		}
+		fsd_update_header_index(last_object_offset, (j4fs_header *)buf);
 	}
 
 	kfree(buf);
@@ -1132,7 +1341,11 @@ int j4fs_create (struct inode * dir, struct dentry * dentry, int mode, struct na
 
 	T(J4FS_TRACE_FS,("%s %d\n",__FUNCTION__,__LINE__));
 
+	j4fs_GrossLock();
 	inode = j4fs_new_inode(dir, dentry, mode);
+	// j4fs_header_index is updated in place; only a reclaim or an unexpected header makes us read it again
+	if(!j4fs_header_index_valid) fsd_build_header_index();
+	j4fs_GrossUnlock();
 
 	if (!IS_ERR(inode)) {
 		inode->i_op = &j4fs_file_inode_operations;
@@ -1163,6 +1376,16 @@ int j4fs_hold_space(int size)
 
 	buf=kmalloc(J4FS_BASIC_UNIT_SIZE,GFP_NOFS);
 
+	j4fs_ReadLock();
+
+	// the last object is the last entry of the in-memory copy of the j4fs_header list
+	if(j4fs_header_index_valid && j4fs_header_index_count)
+	{
+		last_object_offset=fsd_header_index_offset(j4fs_header_index_count-1);
+		raw_inode=(struct j4fs_inode *)&j4fs_header_index[j4fs_header_index_count-1];
+		goto got_last_object;
+	}
+
 	// find existing largest inode number
 	offset=device_info.j4fs_offset;
 	while(offset!=0xffffffff)
@@ -1198,6 +1421,7 @@ int j4fs_hold_space(int size)
 		offset=raw_inode->i_link;
 	}
 
+got_last_object:
 	if(last_object_offset!=0xffffffff)
 	{
 		T(J4FS_TRACE_FS,("%s %d\n",__FUNCTION__,__LINE__));
@@ -1207,11 +1431,13 @@ int j4fs_hold_space(int size)
 		new_object_offset=(new_object_offset+J4FS_BASIC_UNIT_SIZE-1)/J4FS_BASIC_UNIT_SIZE*J4FS_BASIC_UNIT_SIZE;	// 4096 align
 	}
 
+	j4fs_ReadUnlock();
 	kfree(buf);
 	if((new_object_offset+size-1)>device_info.j4fs_end) return 0;
 	else return 1;
 
 error1:
+	j4fs_ReadUnlock();
 	kfree(buf);
 	return 0;
 }
@@ -1249,6 +1475,8 @@ int j4fs_fill_super(struct super_block *sb, void *data, int silent)
 	sb->s_op = &j4fs_sops;
 	sb->s_xattr = NULL;
 
+	init_rwsem(&device_info.grossLock);
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 28)
 	root=j4fs_iget(sb, J4FS_ROOT_INO);
 #else
@@ -1292,8 +1520,6 @@ int j4fs_fill_super(struct super_block *sb, void *data, int silent)
 		goto failed;
 	}
 
-	init_MUTEX(&device_info.grossLock);
-
 #ifdef J4FS_TRANSACTION_LOGGING
 	ret=fsd_initialize_transaction();
 
@@ -1312,6 +1538,9 @@ int j4fs_fill_super(struct super_block *sb, void *data, int silent)
    		goto failed;
 	}
 
+	// Lookups, readdir and reads use this instead of scanning j4fs_header list in flash
+	fsd_build_header_index();
+
 	return 0;
 
 failed:
@@ -1479,6 +1708,7 @@ module_exit(exit_j4fs_fs)
 
 const struct address_space_operations j4fs_aops = {
 	.readpage		= j4fs_readpage,
+	.readpages		= j4fs_readpages,
 	.writepage		= j4fs_writepage,
 #if (J4FS_USE_WRITE_BEGIN_END > 0)
 	.write_begin = j4fs_write_begin,
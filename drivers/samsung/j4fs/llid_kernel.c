@@ -39,6 +39,8 @@
 /* j4fs device node name */
 #define J4FS_DEVNAME			"/dev/block/mmcblk0p4"
 static struct file *j4fs_filp;
+/* Readers run in parallel; their handle is opened O_NONBLOCK once and its flags never change */
+static struct file *j4fs_read_filp;
 // J4FS for moviNAND merged from ROSSI
 
 #else
@@ -67,6 +69,7 @@ int FlashDevRead(j4fs_device_info *dev_ptr, DWORD offset, DWORD length, BYTE *bu
 // J4FS for moviNAND merged from ROSSI
 #ifdef J4FS_USE_MOVI
 	mm_segment_t oldfs;
+	loff_t pos = offset;
 #endif
 // J4FS for moviNAND merged from ROSSI
 
@@ -84,16 +87,14 @@ int FlashDevRead(j4fs_device_info *dev_ptr, DWORD offset, DWORD length, BYTE *bu
 	}
 // J4FS for moviNAND merged from ROSSI
 #elif defined(J4FS_USE_MOVI)
-	if (!j4fs_filp) {
+	if (!j4fs_read_filp) {
 			printk("J4FS not available\n");
 			return J4FS_FAIL;
 		}
-		j4fs_filp->f_flags |= O_NONBLOCK;
 		oldfs = get_fs(); set_fs(get_ds());
-		ret = j4fs_filp->f_op->llseek(j4fs_filp, offset, SEEK_SET);
-		ret = j4fs_filp->f_op->read(j4fs_filp, buffer, length, &j4fs_filp->f_pos);
+		/* Readers run in parallel, so don't share f_pos either */
+		ret = j4fs_read_filp->f_op->read(j4fs_read_filp, buffer, length, &pos);
 		set_fs(oldfs);
-		j4fs_filp->f_flags &= ~O_NONBLOCK;
 		if (ret < 0) {
 			printk(1, "j4fs_filp->read() failed: %d\n", ret);
 			return J4FS_FAIL;
@@ -211,6 +212,15 @@ int FlashDevMount()
 	j4fs_filp = filp_open(J4FS_DEVNAME, O_RDWR|O_SYNC, 0);
 	if (IS_ERR(j4fs_filp)) {
 		printk("FlashDevMount : filp_open() failed~!: %ld\n", PTR_ERR(j4fs_filp));
+		j4fs_filp = NULL;
+		return J4FS_FAIL;
+	}
+	j4fs_read_filp = filp_open(J4FS_DEVNAME, O_RDONLY|O_NONBLOCK, 0);
+	if (IS_ERR(j4fs_read_filp)) {
+		printk("FlashDevMount : filp_open() for read failed~!: %ld\n", PTR_ERR(j4fs_read_filp));
+		j4fs_read_filp = NULL;
+		filp_close(j4fs_filp, NULL);
+		j4fs_filp = NULL;
 		return J4FS_FAIL;
 	}
 	printk("FlashDevMount : filp_open() OK....!\n");
@@ -228,6 +238,10 @@ int FlashDevUnmount()
 {
 // ROSSI Projecct(hyunkwon.kim) 2010.09.06 Add J4FS for Parameter Infomation
 #ifdef J4FS_USE_MOVI
+	if (j4fs_read_filp) {
+		filp_close(j4fs_read_filp, NULL);
+		j4fs_read_filp = NULL;
+	}
 	filp_close(j4fs_filp, NULL);
 	printk("FlashDevUnmount : filp_close() OK....!\n");
 #endif
@@ -43,6 +43,7 @@
 #include <linux/delay.h>
 #include <linux/clk.h>
 #include <linux/cpufreq.h>
+#include <linux/dma-mapping.h>
 
 #include <asm/irq.h>
 
@@ -51,6 +52,10 @@
 
 #include <plat/regs-serial.h>
 
+#ifdef CONFIG_SERIAL_SAMSUNG_RX_DMA
+#include <mach/dma.h>
+#endif
+
 #include "samsung.h"
 
 /* UART name and device definitions */
@@ -191,10 +196,13 @@ static int s3c24xx_serial_rx_fifocnt(struct s3c24xx_uart_port *ourport,
 /* ? - where has parity gone?? */
 #define S3C2410_UERSTAT_PARITY (0x1000)
 
+/* per-character receive path, used for console and flow-controlled
+ * ports where every character may need special handling.
+ */
+
 static irqreturn_t
-s3c24xx_serial_rx_chars(int irq, void *dev_id)
+s3c24xx_serial_rx_chars_slow(struct s3c24xx_uart_port *ourport)
 {
-	struct s3c24xx_uart_port *ourport = dev_id;
 	struct uart_port *port = &ourport->port;
 	struct tty_struct *tty = port->state->port.tty;
 	unsigned int ufcon, ch, flag, ufstat, uerstat;
@@ -277,6 +285,412 @@ s3c24xx_serial_rx_chars(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+/* batched receive path
+ *
+ * the fifo level is read once per burst rather than once per character,
+ * and runs of error-free characters are handed to the tty layer in a
+ * single tty_insert_flip_string() call. with a deep rx trigger level this
+ * keeps the interrupt and mmio load down on high rate links such as the
+ * bluetooth hci uart.
+ *
+ * where UFSTAT reports errors in the fifo (rx_fifoerr), a burst without
+ * errors is read with URXH accesses only, UERSTAT is read once for the
+ * burst to catch an overrun.
+ */
+
+#define S3C24XX_SERIAL_RX_BATCH	(64)
+
+#ifdef CONFIG_SERIAL_SAMSUNG_RX_DMA
+static void s3c24xx_serial_rx_dma_start(struct s3c24xx_uart_port *ourport);
+#endif
+
+static irqreturn_t
+s3c24xx_serial_rx_chars(int irq, void *dev_id)
+{
+	struct s3c24xx_uart_port *ourport = dev_id;
+	struct uart_port *port = &ourport->port;
+	struct s3c24xx_uart_info *info = ourport->info;
+	struct tty_struct *tty = port->state->port.tty;
+	unsigned char buf[S3C24XX_SERIAL_RX_BATCH];
+	unsigned int ch, flag, ufstat, uerstat, count, n, len = 0;
+	int budget = max_t(int, port->fifosize, 64);
+	int max_count = budget;
+
+	if ((port->flags & UPF_CONS_FLOW) ||
+	    (port->cons && port->cons->index == port->line))
+		return s3c24xx_serial_rx_chars_slow(ourport);
+
+	while (max_count > 0) {
+		ufstat = rd_regl(port, S3C2410_UFSTAT);
+		count = s3c24xx_serial_rx_fifocnt(ourport, ufstat);
+		if (count == 0)
+			break;
+
+		count = min_t(unsigned int, count, max_count);
+		max_count -= count;
+
+		if (info->rx_fifoerr && !(ufstat & info->rx_fifoerr)) {
+			uerstat = rd_regl(port, S3C2410_UERSTAT);
+			port->icount.rx += count;
+
+			while (count) {
+				n = min_t(unsigned int, count,
+					  sizeof(buf) - len);
+				readsb(portaddr(port, S3C2410_URXH),
+				       buf + len, n);
+				len += n;
+				count -= n;
+
+				if (len == sizeof(buf)) {
+					tty_insert_flip_string(tty, buf, len);
+					len = 0;
+				}
+			}
+
+			/* an overrun is not tied to a fifo entry */
+			if (unlikely(uerstat & S3C2410_UERSTAT_OVERRUN)) {
+				if (len) {
+					tty_insert_flip_string(tty, buf, len);
+					len = 0;
+				}
+
+				port->icount.overrun++;
+				if (!(port->ignore_status_mask &
+				      S3C2410_UERSTAT_OVERRUN))
+					tty_insert_flip_char(tty, 0,
+							     TTY_OVERRUN);
+			}
+			continue;
+		}
+
+		while (count--) {
+			uerstat = rd_regl(port, S3C2410_UERSTAT);
+			ch = rd_regb(port, S3C2410_URXH);
+			port->icount.rx++;
+
+			if (likely(!(uerstat & S3C2410_UERSTAT_ANY))) {
+				buf[len++] = ch;
+				if (len == sizeof(buf)) {
+					tty_insert_flip_string(tty, buf, len);
+					len = 0;
+				}
+				continue;
+			}
+
+			/* flush the good run so ordering is kept */
+			if (len) {
+				tty_insert_flip_string(tty, buf, len);
+				len = 0;
+			}
+
+			dbg("rxerr: port ch=0x%02x, rxs=0x%08x\n",
+			    ch, uerstat);
+
+			if (uerstat & S3C2410_UERSTAT_BREAK) {
+				port->icount.brk++;
+				if (uart_handle_break(port))
+					continue;
+			}
+
+			if (uerstat & S3C2410_UERSTAT_FRAME)
+				port->icount.frame++;
+			if (uerstat & S3C2410_UERSTAT_OVERRUN)
+				port->icount.overrun++;
+
+			uerstat &= port->read_status_mask;
+
+			flag = TTY_NORMAL;
+			if (uerstat & S3C2410_UERSTAT_BREAK)
+				flag = TTY_BREAK;
+			else if (uerstat & S3C2410_UERSTAT_PARITY)
+				flag = TTY_PARITY;
+			else if (uerstat & (S3C2410_UERSTAT_FRAME |
+					    S3C2410_UERSTAT_OVERRUN))
+				flag = TTY_FRAME;
+
+			uart_insert_char(port, uerstat,
+					 S3C2410_UERSTAT_OVERRUN, ch, flag);
+		}
+	}
+
+	if (len)
+		tty_insert_flip_string(tty, buf, len);
+
+#ifdef CONFIG_SERIAL_SAMSUNG_RX_DMA
+	/* a trigger level burst rather than a short packet, let the dma
+	 * ring take the rest of it */
+	if (ourport->rx_dma_buf &&
+	    budget - max_count >= S3C24XX_SERIAL_RX_BATCH)
+		s3c24xx_serial_rx_dma_start(ourport);
+#endif
+
+	tty_flip_buffer_push(tty);
+
+	return IRQ_HANDLED;
+}
+
+#ifdef CONFIG_SERIAL_SAMSUNG_RX_DMA
+
+/* dma receive ring
+ *
+ * on ports flagged S3C2410_UARTCFG_RXDMA a circular PL330 transfer runs
+ * over a coherent ring for as long as the port is open. the uart only
+ * raises dma requests while UCON selects dma receive mode, which the rx
+ * interrupt switches on after a full burst, masking itself. the ring is
+ * drained at each period and by a poll timer, and when a poll finds no new
+ * data the port goes back to interrupt mode; anything that arrived after
+ * the switch is still in the fifo for the rx interrupt.
+ *
+ * receive errors are not reported while the ring runs.
+ */
+
+#define S3C24XX_SERIAL_RX_DMA_PERIOD	(1024)
+#define S3C24XX_SERIAL_RX_DMA_PERIODS	(4)
+#define S3C24XX_SERIAL_RX_DMA_SIZE	(S3C24XX_SERIAL_RX_DMA_PERIOD * \
+					 S3C24XX_SERIAL_RX_DMA_PERIODS)
+#define S3C24XX_SERIAL_RX_DMA_POLL	(msecs_to_jiffies(5))
+
+static struct s3c2410_dma_client s3c24xx_serial_dma_client = {
+	.name		= "samsung-uart-rx",
+};
+
+static const enum dma_ch s3c24xx_serial_rx_dma_chans[] = {
+	DMACH_UART0_RX,
+	DMACH_UART1_RX,
+	DMACH_UART2_RX,
+	DMACH_UART3_RX,
+	DMACH_UART4_RX,
+};
+
+/* copy the ring from the tail up to the dma position into the tty buffer.
+ * called with the port lock held, the caller pushes the tty buffer. */
+
+static unsigned int s3c24xx_serial_rx_dma_drain(struct s3c24xx_uart_port *ourport)
+{
+	struct uart_port *port = &ourport->port;
+	struct tty_struct *tty = port->state->port.tty;
+	unsigned int tail = ourport->rx_dma_tail;
+	unsigned int pos, n, total = 0;
+	dma_addr_t src, dst;
+
+	if (s3c2410_dma_getposition(ourport->rx_dma_ch, &src, &dst) < 0)
+		return 0;
+
+	if (dst < ourport->rx_dma_addr ||
+	    dst > ourport->rx_dma_addr + S3C24XX_SERIAL_RX_DMA_SIZE)
+		return 0;
+
+	pos = (dst - ourport->rx_dma_addr) % S3C24XX_SERIAL_RX_DMA_SIZE;
+
+	while (tail != pos) {
+		n = (pos > tail ? pos : S3C24XX_SERIAL_RX_DMA_SIZE) - tail;
+
+		if (tty)
+			tty_insert_flip_string(tty, ourport->rx_dma_buf + tail,
+					       n);
+
+		tail = (tail + n) % S3C24XX_SERIAL_RX_DMA_SIZE;
+		total += n;
+	}
+
+	ourport->rx_dma_tail = tail;
+	port->icount.rx += total;
+
+	return total;
+}
+
+/* called from the rx interrupt */
+
+static void s3c24xx_serial_rx_dma_start(struct s3c24xx_uart_port *ourport)
+{
+	struct uart_port *port = &ourport->port;
+	unsigned long flags;
+	unsigned int ucon;
+
+	spin_lock_irqsave(&port->lock, flags);
+
+	ucon = rd_regl(port, S3C2410_UCON);
+	ucon &= ~S3C2410_UCON_RXMODEMASK;
+	wr_regl(port, S3C2410_UCON, ucon | S3C2410_UCON_RXDMAMODE);
+
+	disable_irq_nosync(ourport->rx_irq);
+	ourport->rx_dma_active = 1;
+	mod_timer(&ourport->rx_dma_timer, jiffies + S3C24XX_SERIAL_RX_DMA_POLL);
+
+	spin_unlock_irqrestore(&port->lock, flags);
+}
+
+static void s3c24xx_serial_rx_dma_poll(unsigned long data)
+{
+	struct s3c24xx_uart_port *ourport = (struct s3c24xx_uart_port *)data;
+	struct uart_port *port = &ourport->port;
+	struct tty_struct *tty = port->state->port.tty;
+	unsigned long flags;
+	unsigned int ucon, count;
+
+	spin_lock_irqsave(&port->lock, flags);
+
+	if (!ourport->rx_dma_active) {
+		spin_unlock_irqrestore(&port->lock, flags);
+		return;
+	}
+
+	count = s3c24xx_serial_rx_dma_drain(ourport);
+	if (count) {
+		mod_timer(&ourport->rx_dma_timer,
+			  jiffies + S3C24XX_SERIAL_RX_DMA_POLL);
+		spin_unlock_irqrestore(&port->lock, flags);
+		goto push;
+	}
+
+	/* idle, hand the port back to the rx interrupt. the UCON read
+	 * back makes sure no new dma request is raised before the ring is
+	 * drained a last time. */
+
+	ucon = rd_regl(port, S3C2410_UCON);
+	ucon &= ~S3C2410_UCON_RXMODEMASK;
+	wr_regl(port, S3C2410_UCON, ucon | S3C2410_UCON_RXIRQMODE);
+	rd_regl(port, S3C2410_UCON);
+
+	count = s3c24xx_serial_rx_dma_drain(ourport);
+	ourport->rx_dma_active = 0;
+
+	spin_unlock_irqrestore(&port->lock, flags);
+	enable_irq(ourport->rx_irq);
+
+ push:
+	if (count && tty)
+		tty_flip_buffer_push(tty);
+}
+
+static void s3c24xx_serial_rx_dma_done(struct s3c2410_dma_chan *chan,
+				       void *id, int size,
+				       enum s3c2410_dma_buffresult res)
+{
+	struct s3c24xx_uart_port *ourport = id;
+	struct uart_port *port = &ourport->port;
+	struct tty_struct *tty = port->state->port.tty;
+	unsigned long flags;
+	unsigned int count = 0;
+
+	if (res != S3C2410_RES_OK)
+		return;
+
+	spin_lock_irqsave(&port->lock, flags);
+	if (ourport->rx_dma_active)
+		count = s3c24xx_serial_rx_dma_drain(ourport);
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	if (count && tty)
+		tty_flip_buffer_push(tty);
+}
+
+static void s3c24xx_serial_rx_dma_init(struct s3c24xx_uart_port *ourport)
+{
+	struct uart_port *port = &ourport->port;
+	struct s3c2410_uartcfg *cfg = s3c24xx_port_to_cfg(port);
+	unsigned int ch;
+
+	ourport->rx_dma_buf = NULL;
+	ourport->rx_dma_active = 0;
+	ourport->rx_dma_tail = 0;
+
+	if (cfg == NULL || !(cfg->flags & S3C2410_UARTCFG_RXDMA) ||
+	    cfg->hwport >= ARRAY_SIZE(s3c24xx_serial_rx_dma_chans) ||
+	    (port->cons && port->cons->index == port->line))
+		return;
+
+	ch = s3c24xx_serial_rx_dma_chans[cfg->hwport];
+
+	ourport->rx_dma_buf = dma_alloc_coherent(port->dev,
+						 S3C24XX_SERIAL_RX_DMA_SIZE,
+						 &ourport->rx_dma_addr,
+						 GFP_KERNEL);
+	if (ourport->rx_dma_buf == NULL)
+		goto err;
+
+	if (s3c2410_dma_request(ch, &s3c24xx_serial_dma_client, NULL) < 0)
+		goto err_free;
+
+	s3c2410_dma_set_buffdone_fn(ch, s3c24xx_serial_rx_dma_done);
+	s3c2410_dma_devconfig(ch, S3C2410_DMASRC_HW,
+			      port->mapbase + S3C2410_URXH);
+	s3c2410_dma_config(ch, 1);
+	s3c2410_dma_setflags(ch, S3C2410_DMAF_CIRCULAR);
+
+	if (s3c2410_dma_enqueue_ring(ch, ourport, ourport->rx_dma_addr,
+				     S3C24XX_SERIAL_RX_DMA_PERIOD,
+				     S3C24XX_SERIAL_RX_DMA_PERIODS) < 0)
+		goto err_chan;
+
+	s3c2410_dma_ctrl(ch, S3C2410_DMAOP_START);
+
+	ourport->rx_dma_ch = ch;
+	setup_timer(&ourport->rx_dma_timer, s3c24xx_serial_rx_dma_poll,
+		    (unsigned long)ourport);
+	return;
+
+ err_chan:
+	s3c2410_dma_free(ch, &s3c24xx_serial_dma_client);
+ err_free:
+	dma_free_coherent(port->dev, S3C24XX_SERIAL_RX_DMA_SIZE,
+			  ourport->rx_dma_buf, ourport->rx_dma_addr);
+	ourport->rx_dma_buf = NULL;
+ err:
+	printk(KERN_WARNING "%s: no rx dma, using interrupts\n",
+	       s3c24xx_serial_portname(port));
+}
+
+/* called with the rx interrupt disabled */
+
+static void s3c24xx_serial_rx_dma_exit(struct s3c24xx_uart_port *ourport)
+{
+	struct uart_port *port = &ourport->port;
+	unsigned long flags;
+	unsigned int ucon;
+	int active;
+
+	if (ourport->rx_dma_buf == NULL)
+		return;
+
+	del_timer_sync(&ourport->rx_dma_timer);
+
+	spin_lock_irqsave(&port->lock, flags);
+
+	active = ourport->rx_dma_active;
+	if (active) {
+		ucon = rd_regl(port, S3C2410_UCON);
+		ucon &= ~S3C2410_UCON_RXMODEMASK;
+		wr_regl(port, S3C2410_UCON, ucon | S3C2410_UCON_RXIRQMODE);
+		ourport->rx_dma_active = 0;
+	}
+
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	/* balance the disable done by s3c24xx_serial_rx_dma_start() */
+	if (active)
+		enable_irq(ourport->rx_irq);
+
+	s3c2410_dma_ctrl(ourport->rx_dma_ch, S3C2410_DMAOP_FLUSH);
+	s3c2410_dma_free(ourport->rx_dma_ch, &s3c24xx_serial_dma_client);
+
+	dma_free_coherent(port->dev, S3C24XX_SERIAL_RX_DMA_SIZE,
+			  ourport->rx_dma_buf, ourport->rx_dma_addr);
+	ourport->rx_dma_buf = NULL;
+}
+
+#else
+
+static inline void s3c24xx_serial_rx_dma_init(struct s3c24xx_uart_port *ourport)
+{
+}
+
+static inline void s3c24xx_serial_rx_dma_exit(struct s3c24xx_uart_port *ourport)
+{
+}
+
+#endif /* CONFIG_SERIAL_SAMSUNG_RX_DMA */
+
 static irqreturn_t s3c24xx_serial_tx_chars(int irq, void *id)
 {
 	struct s3c24xx_uart_port *ourport = id;
@@ -398,6 +812,7 @@ static void s3c24xx_serial_shutdown(struct uart_port *port)
 
 	if (ourport->rx_claimed) {
 		disable_irq(ourport->rx_irq);
+		s3c24xx_serial_rx_dma_exit(ourport);
 		free_irq(ourport->rx_irq, ourport);
 		ourport->rx_claimed = 0;
 		rx_enabled(port) = 0;
@@ -415,11 +830,14 @@ static int s3c24xx_serial_startup(struct uart_port *port)
 
 	rx_enabled(port) = 1;
 
+	s3c24xx_serial_rx_dma_init(ourport);
+
 	ret = request_irq(ourport->rx_irq, s3c24xx_serial_rx_chars, 0,
 			  s3c24xx_serial_portname(port), ourport);
 
 	if (ret != 0) {
 		printk(KERN_ERR "cannot get irq %d\n", ourport->rx_irq);
+		s3c24xx_serial_rx_dma_exit(ourport);
 		return ret;
 	}
 
@@ -17,6 +17,7 @@ struct s3c24xx_uart_info {
 	unsigned long		rx_fifomask;
 	unsigned long		rx_fifoshift;
 	unsigned long		rx_fifofull;
+	unsigned long		rx_fifoerr;	/* a fifo entry has an error */
 	unsigned long		tx_fifomask;
 	unsigned long		tx_fifoshift;
 	unsigned long		tx_fifofull;
@@ -52,6 +53,16 @@ struct s3c24xx_uart_port {
 #ifdef CONFIG_CPU_FREQ
 	struct notifier_block		freq_transition;
 #endif
+
+#ifdef CONFIG_SERIAL_SAMSUNG_RX_DMA
+	/* rx dma ring, NULL rx_dma_buf if the port uses interrupts only */
+	unsigned char			*rx_dma_buf;
+	dma_addr_t			rx_dma_addr;
+	unsigned int			rx_dma_ch;
+	unsigned int			rx_dma_tail;
+	unsigned int			rx_dma_active;
+	struct timer_list		rx_dma_timer;
+#endif
 };
 
 /* conversion functions */
@@ -31,6 +31,9 @@
 #define SEND_RESET_ACK		8
 #define SET_ZLP_DATA 		9
 #define GET_HIGH_FULL_SPEED 	10
+#define SEND_FILE_WITH_HEADER	11
+#define RECEIVE_FILE		12
+#define GET_XFER_STATS		13
 #define SIG_SETUP		44
 
 /*PIMA15740-2000 spec*/
@@ -52,5 +55,32 @@ struct usb_mtp_ctrlrequest {
 	struct usb_ctrlrequest	setup;
 };
 
+/*
+ * Argument of SEND_FILE_WITH_HEADER and RECEIVE_FILE.
+ * For SEND_FILE_WITH_HEADER the driver builds the 12 byte data
+ * container header from code and transaction_id and sends it in
+ * front of the file data. For RECEIVE_FILE the daemon has already
+ * read the container header with read(), and length is the size of
+ * the data phase still to come.
+ */
+struct mtpg_file_xfer {
+	__u64		offset;
+	__u64		length;
+	int		fd;
+	__u32		transaction_id;
+	__u16		code;
+	__u16		reserved;
+};
+
+/* Returned by GET_XFER_STATS, totals since the gadget was bound */
+struct mtpg_xfer_stats {
+	__u64		send_bytes;
+	__u64		send_usecs;
+	__u64		receive_bytes;
+	__u64		receive_usecs;
+	__u32		send_files;
+	__u32		receive_files;
+};
+
 #endif /* __F_MTP_H */
 
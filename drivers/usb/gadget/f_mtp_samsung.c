@@ -46,9 +46,13 @@
 #include <linux/usb/ch9.h>
 #include <linux/usb/composite.h>
 #include <linux/usb/gadget.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/ktime.h>
 
 #include <linux/sched.h>
 #include <asm-generic/siginfo.h>
+#include <asm/unaligned.h>
 
 #include "f_mtp.h"
 #include "gadget_chips.h"
@@ -100,6 +104,16 @@
 #define RX_REQ_MAX		 4
 #define TX_REQ_MAX		 4
 
+/* requests used for SEND_FILE_WITH_HEADER and RECEIVE_FILE, kept
+ * separate so a file transfer can keep the endpoint busy while the
+ * next buffer is read from or written to the page cache */
+#define FILE_BUFFER_SIZE	 16384
+#define FILE_RX_REQ_MAX		 8
+#define FILE_TX_REQ_MAX		 8
+
+#define MTP_CONTAINER_HEADER_SIZE	12
+#define MTP_CONTAINER_TYPE_DATA		2
+
 #define DRIVER_NAME		 "usb_mtp_gadget"
 
 
@@ -151,6 +165,19 @@ struct mtpg_dev {
 	atomic_t 		wintfd_excl;
 	char cancel_io_buf[USB_PTPREQUEST_CANCELIO_SIZE+1];
 
+	/* rx_idle requests mtpg_read() has queued on bulk_out */
+	atomic_t		rx_queued;
+
+	struct list_head	tx_file_idle;
+	struct list_head	rx_file_idle;
+	struct list_head	rx_file_done;
+	struct usb_request	*tx_file_req[FILE_TX_REQ_MAX];
+	struct usb_request	*rx_file_req[FILE_RX_REQ_MAX];
+	int			tx_file_queued;
+	int			rx_file_queued;
+	int			xfer_cancel;
+	struct mtpg_xfer_stats	stats;
+
 };
 
 /* Global mtpg_dev Structure
@@ -418,6 +445,7 @@ static ssize_t mtpg_read(struct file *fp, char __user *buf,
 requeue_req:
 			req->length = BULK_BUFFER_SIZE;
 			DEBUG_MTPR("[%s]\t%d: ---------- usb-ep-queue \n", __FUNCTION__,__LINE__);
+			atomic_inc(&dev->rx_queued);
 			ret = usb_ep_queue(dev->bulk_out, req, GFP_ATOMIC);
 
 			DEBUG_MTPR("*********** [%s]\t%d: Endpoint : %s \n",__func__,__LINE__, dev->bulk_out->name);
@@ -425,6 +453,7 @@ requeue_req:
 			if (ret < 0) {
 				r = -EIO;
 				dev->error = 1;
+				atomic_dec(&dev->rx_queued);
 				req_put(dev, &dev->rx_idle, req);
 				printk("*****[%s] \t line %d, RETURN ERROR r = %d !!!!!!!!! \n", __FUNCTION__,__LINE__,r);
 				goto fail;
@@ -589,6 +618,377 @@ static ssize_t mtpg_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+static int mtpg_xfer_status(struct mtpg_dev *dev, int ret)
+{
+	if (ret < 0)
+		return ret;
+	if (dev->xfer_cancel)
+		return -ECANCELED;
+	return -EIO;
+}
+
+/* take back every file request still owned by the controller */
+static void mtpg_file_flush(struct mtpg_dev *dev, struct usb_ep *ep,
+		struct usb_request **reqs, int nreqs, int *queued,
+		wait_queue_head_t *wq)
+{
+	int i;
+
+	for (i = 0; i < nreqs; i++)
+		usb_ep_dequeue(ep, reqs[i]);
+
+	wait_event(*wq, *queued == 0);
+}
+
+static void mtpg_complete_file_in(struct usb_ep *ep, struct usb_request *req)
+{
+	struct mtpg_dev *dev = the_mtpg;
+	unsigned long flags;
+
+	DEBUG_MTPW("[%s] \t %d req->status is = %d\n", __FUNCTION__,__LINE__, req->status);
+
+	if (req->status != 0 && req->status != -ECONNRESET)
+		dev->error = 1;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	list_add_tail(&req->list, &dev->tx_file_idle);
+	dev->tx_file_queued--;
+	spin_unlock_irqrestore(&dev->lock, flags);
+	wake_up(&dev->write_wq);
+}
+
+static void mtpg_complete_file_out(struct usb_ep *ep, struct usb_request *req)
+{
+	struct mtpg_dev *dev = the_mtpg;
+	unsigned long flags;
+
+	DEBUG_MTPR("[%s] \t %d req->status is = %d\n", __FUNCTION__,__LINE__, req->status);
+
+	if (req->status != 0 && req->status != -ECONNRESET)
+		dev->error = 1;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	list_add_tail(&req->list, &dev->rx_file_done);
+	dev->rx_file_queued--;
+	spin_unlock_irqrestore(&dev->lock, flags);
+	wake_up(&dev->read_wq);
+}
+
+/*
+ * Send the data phase of an MTP transaction straight from a file.
+ * The container header goes into the first request together with
+ * the start of the file so the host does not see a short packet
+ * after 12 bytes. Up to FILE_TX_REQ_MAX requests are in flight, so
+ * vfs_read() of the next buffer overlaps the bulk-in transfers.
+ */
+static int mtpg_send_file(struct mtpg_dev *dev, struct file *filp,
+		struct mtpg_file_xfer *x)
+{
+	struct usb_request *req;
+	loff_t offset = x->offset;
+	u64 count = x->length;
+	u64 total = count + MTP_CONTAINER_HEADER_SIZE;
+	int header = 1;
+	int r = 0, ret, xfer, len;
+
+	DEBUG_MTPW("[%s] offset %lld length %llu\n", __func__, offset, count);
+
+	while (count > 0 || header) {
+		req = NULL;
+		ret = wait_event_interruptible(dev->write_wq,
+				(req = req_get(dev, &dev->tx_file_idle)) ||
+				dev->error || dev->xfer_cancel);
+		if (!req || dev->error || dev->xfer_cancel) {
+			if (req)
+				req_put(dev, &dev->tx_file_idle, req);
+			r = mtpg_xfer_status(dev, ret);
+			break;
+		}
+
+		xfer = 0;
+		if (header) {
+			put_unaligned_le32(total > 0xffffffffULL ?
+					0xffffffff : (u32)total, req->buf);
+			put_unaligned_le16(MTP_CONTAINER_TYPE_DATA, req->buf + 4);
+			put_unaligned_le16(x->code, req->buf + 6);
+			put_unaligned_le32(x->transaction_id, req->buf + 8);
+			xfer = MTP_CONTAINER_HEADER_SIZE;
+			header = 0;
+		}
+
+		len = min_t(u64, count, FILE_BUFFER_SIZE - xfer);
+		if (len) {
+			ret = vfs_read(filp, (char __user *)req->buf + xfer,
+					len, &offset);
+			if (ret <= 0) {
+				/* the host was promised x->length bytes */
+				req_put(dev, &dev->tx_file_idle, req);
+				r = ret < 0 ? ret : -EIO;
+				break;
+			}
+			xfer += ret;
+			count -= ret;
+		}
+
+		req->length = xfer;
+		spin_lock_irq(&dev->lock);
+		dev->tx_file_queued++;
+		spin_unlock_irq(&dev->lock);
+		ret = usb_ep_queue(dev->bulk_in, req, GFP_KERNEL);
+		if (ret < 0) {
+			printk("[%s]\t%d: usb_ep_queue failed %d\n", __func__, __LINE__, ret);
+			spin_lock_irq(&dev->lock);
+			dev->tx_file_queued--;
+			spin_unlock_irq(&dev->lock);
+			req_put(dev, &dev->tx_file_idle, req);
+			dev->error = 1;
+			r = -EIO;
+			break;
+		}
+	}
+
+	/* a data phase that fills its last packet is ended by a ZLP */
+	if (!r && (total % dev->bulk_in->maxpacket) == 0) {
+		req = NULL;
+		ret = wait_event_interruptible(dev->write_wq,
+				(req = req_get(dev, &dev->tx_file_idle)) ||
+				dev->error || dev->xfer_cancel);
+		if (!req || dev->error || dev->xfer_cancel) {
+			if (req)
+				req_put(dev, &dev->tx_file_idle, req);
+			r = mtpg_xfer_status(dev, ret);
+		} else {
+			req->length = 0;
+			spin_lock_irq(&dev->lock);
+			dev->tx_file_queued++;
+			spin_unlock_irq(&dev->lock);
+			ret = usb_ep_queue(dev->bulk_in, req, GFP_KERNEL);
+			if (ret < 0) {
+				spin_lock_irq(&dev->lock);
+				dev->tx_file_queued--;
+				spin_unlock_irq(&dev->lock);
+				req_put(dev, &dev->tx_file_idle, req);
+				dev->error = 1;
+				r = -EIO;
+			}
+		}
+	}
+
+	if (!r) {
+		ret = wait_event_interruptible(dev->write_wq,
+				dev->tx_file_queued == 0 ||
+				dev->error || dev->xfer_cancel);
+		if (dev->tx_file_queued)
+			r = mtpg_xfer_status(dev, ret);
+		else if (dev->error)
+			r = -EIO;
+	}
+
+	if (r)
+		mtpg_file_flush(dev, dev->bulk_in, dev->tx_file_req,
+				FILE_TX_REQ_MAX, &dev->tx_file_queued,
+				&dev->write_wq);
+
+	DEBUG_MTPW("[%s] returning %d\n", __func__, r);
+	return r;
+}
+
+/*
+ * Receive the data phase of an MTP transaction straight into a file.
+ * The daemon has already read the container header, and mtpg_read()
+ * may have more of the data sitting in (or queued on) the rx_idle
+ * requests, so that is drained first. After that the file requests
+ * are queued for no more than what is left of the data phase, so a
+ * request never swallows the next command container.
+ */
+static int mtpg_receive_file(struct mtpg_dev *dev, struct file *filp,
+		struct mtpg_file_xfer *x)
+{
+	struct usb_request *req;
+	loff_t offset = x->offset;
+	u64 count = x->length;
+	u64 queued = 0;
+	unsigned maxpacket = dev->bulk_out->maxpacket;
+	int r = 0, ret, xfer, len;
+
+	DEBUG_MTPR("[%s] offset %lld length %llu\n", __func__, offset, count);
+
+	while (count > 0) {
+		if (dev->read_count == 0) {
+			req = NULL;
+			ret = wait_event_interruptible(dev->read_wq,
+					(req = req_get(dev, &dev->rx_done)) ||
+					atomic_read(&dev->rx_queued) == 0 ||
+					dev->error || dev->xfer_cancel);
+			if (dev->error || dev->xfer_cancel || ret < 0) {
+				if (req)
+					req_put(dev, &dev->rx_done, req);
+				r = mtpg_xfer_status(dev, ret);
+				goto out;
+			}
+			if (!req)
+				break;
+			if (req->actual == 0) {
+				req_put(dev, &dev->rx_idle, req);
+				continue;
+			}
+			dev->read_req = req;
+			dev->read_buf = req->buf;
+			dev->read_count = req->actual;
+		}
+
+		xfer = min_t(u64, dev->read_count, count);
+		ret = vfs_write(filp, (char __user *)dev->read_buf, xfer, &offset);
+		if (ret != xfer) {
+			r = ret < 0 ? ret : -EIO;
+			goto out;
+		}
+		dev->read_buf += xfer;
+		dev->read_count -= xfer;
+		count -= xfer;
+
+		if (dev->read_count == 0) {
+			req_put(dev, &dev->rx_idle, dev->read_req);
+			dev->read_req = 0;
+		}
+	}
+
+	while (count > 0) {
+		while (queued < count &&
+		       (req = req_get(dev, &dev->rx_file_idle))) {
+			len = min_t(u64, count - queued, FILE_BUFFER_SIZE);
+			req->length = roundup(len, maxpacket);
+			spin_lock_irq(&dev->lock);
+			dev->rx_file_queued++;
+			spin_unlock_irq(&dev->lock);
+			ret = usb_ep_queue(dev->bulk_out, req, GFP_KERNEL);
+			if (ret < 0) {
+				printk("[%s]\t%d: usb_ep_queue failed %d\n", __func__, __LINE__, ret);
+				spin_lock_irq(&dev->lock);
+				dev->rx_file_queued--;
+				spin_unlock_irq(&dev->lock);
+				req_put(dev, &dev->rx_file_idle, req);
+				dev->error = 1;
+				r = -EIO;
+				goto out;
+			}
+			queued += req->length;
+		}
+
+		req = NULL;
+		ret = wait_event_interruptible(dev->read_wq,
+				(req = req_get(dev, &dev->rx_file_done)) ||
+				dev->error || dev->xfer_cancel);
+		if (!req || dev->error || dev->xfer_cancel) {
+			if (req)
+				req_put(dev, &dev->rx_file_idle, req);
+			r = mtpg_xfer_status(dev, ret);
+			goto out;
+		}
+
+		queued -= req->length;
+		xfer = min_t(u64, req->actual, count);
+		if (xfer) {
+			ret = vfs_write(filp, (char __user *)req->buf, xfer, &offset);
+			if (ret != xfer) {
+				req_put(dev, &dev->rx_file_idle, req);
+				r = ret < 0 ? ret : -EIO;
+				goto out;
+			}
+			count -= xfer;
+		}
+
+		/* a short packet ends the data phase */
+		if (req->actual < req->length && count > 0) {
+			req_put(dev, &dev->rx_file_idle, req);
+			r = -EIO;
+			goto out;
+		}
+		req_put(dev, &dev->rx_file_idle, req);
+	}
+
+out:
+	if (dev->rx_file_queued)
+		mtpg_file_flush(dev, dev->bulk_out, dev->rx_file_req,
+				FILE_RX_REQ_MAX, &dev->rx_file_queued,
+				&dev->read_wq);
+	while ((req = req_get(dev, &dev->rx_file_done)))
+		req_put(dev, &dev->rx_file_idle, req);
+
+	DEBUG_MTPR("[%s] returning %d\n", __func__, r);
+	return r;
+}
+
+static int mtpg_file_ioctl(struct mtpg_dev *dev, unsigned int code,
+		void __user *arg)
+{
+	struct mtpg_file_xfer x;
+	struct file *filp;
+	mm_segment_t old_fs;
+	atomic_t *excl;
+	ktime_t start;
+	u64 usecs;
+	int ret;
+
+	if (copy_from_user(&x, arg, sizeof(x)))
+		return -EFAULT;
+
+	excl = (code == SEND_FILE_WITH_HEADER) ?
+		&dev->write_excl : &dev->read_excl;
+	if (_lock(excl))
+		return -EBUSY;
+
+	if (dev->error || !dev->online) {
+		ret = -EIO;
+		goto out_unlock;
+	}
+
+	filp = fget(x.fd);
+	if (!filp) {
+		ret = -EBADF;
+		goto out_unlock;
+	}
+
+	old_fs = get_fs();
+	set_fs(KERNEL_DS);
+	start = ktime_get();
+
+	/* a cancel that came in while no transfer was running is stale */
+	dev->xfer_cancel = 0;
+
+	if (code == SEND_FILE_WITH_HEADER)
+		ret = mtpg_send_file(dev, filp, &x);
+	else
+		ret = mtpg_receive_file(dev, filp, &x);
+
+	usecs = ktime_to_us(ktime_sub(ktime_get(), start));
+	set_fs(old_fs);
+	fput(filp);
+
+	/* the cancel, if any, was for this transfer */
+	dev->xfer_cancel = 0;
+
+	if (!ret) {
+		if (code == SEND_FILE_WITH_HEADER) {
+			dev->stats.send_bytes += x.length;
+			dev->stats.send_usecs += usecs;
+			dev->stats.send_files++;
+		} else {
+			dev->stats.receive_bytes += x.length;
+			dev->stats.receive_usecs += usecs;
+			dev->stats.receive_files++;
+		}
+	}
+
+	DEBUG_MTPB("[%s] %s %llu bytes in %llu us, ret %d\n", __func__,
+		code == SEND_FILE_WITH_HEADER ? "sent" : "received",
+		x.length, usecs, ret);
+
+out_unlock:
+	_unlock(excl);
+	return ret;
+}
+
 /*Fixme for Interrupt Transfer*/
 static void interrupt_complete(struct usb_ep *ep, struct usb_request *req )
 {
@@ -759,6 +1159,16 @@ static long  mtpg_ioctl(struct file *fd, unsigned int code, unsigned long arg)
 
 			break;
 
+		case SEND_FILE_WITH_HEADER:
+		case RECEIVE_FILE:
+			status = mtpg_file_ioctl(dev, code, (void __user *)arg);
+			break;
+		case GET_XFER_STATS:
+			if (copy_to_user((void __user *)arg, &dev->stats,
+					sizeof(dev->stats)))
+				status = -EFAULT;
+			break;
+
 		default:
 			status = -ENOTTY;
 	}
@@ -863,6 +1273,7 @@ static void mtpg_complete_out(struct usb_ep *ep, struct usb_request *req)
 	struct mtpg_dev *dev = the_mtpg;
 
 	DEBUG_MTPB("[%s] \tline = [%d]req->status is = %d \n", __func__,__LINE__, req->status);
+	atomic_dec(&dev->rx_queued);
 	if (req->status != 0) {
 		dev->error = 1;
 
@@ -880,6 +1291,7 @@ static void mtpg_function_unbind(struct usb_configuration *c, struct usb_functio
 {
 	struct mtpg_dev	*dev = func_to_dev(f);
 	struct usb_request *req;
+	int i;
 
 	DEBUG_MTPB("[%s] \tline = [%d] \n", __func__,__LINE__);
 
@@ -894,6 +1306,11 @@ static void mtpg_function_unbind(struct usb_configuration *c, struct usb_functio
 	dev->error = 1;
 	spin_unlock_irq(&dev->lock);
 
+	for (i = 0; i < FILE_RX_REQ_MAX; i++)
+		mtpg_request_free(dev->rx_file_req[i], dev->bulk_out);
+	for (i = 0; i < FILE_TX_REQ_MAX; i++)
+		mtpg_request_free(dev->tx_file_req[i], dev->bulk_in);
+
 	misc_deregister(&mtpg_device);
 	kfree(the_mtpg);
 	the_mtpg = NULL;
@@ -974,6 +1391,24 @@ static int __init mtpg_function_bind(struct usb_configuration *c, struct usb_fun
 		req_put(mtpg, &mtpg->tx_idle, req);
 	}
 
+	for (i = 0; i < FILE_RX_REQ_MAX; i++) {
+		req = mtpg_request_new(mtpg->bulk_out, FILE_BUFFER_SIZE);
+		if (!req)
+			goto out;
+		req->complete = mtpg_complete_file_out;
+		mtpg->rx_file_req[i] = req;
+		req_put(mtpg, &mtpg->rx_file_idle, req);
+	}
+
+	for (i = 0; i < FILE_TX_REQ_MAX; i++) {
+		req = mtpg_request_new(mtpg->bulk_in, FILE_BUFFER_SIZE);
+		if (!req)
+			goto out;
+		req->complete = mtpg_complete_file_in;
+		mtpg->tx_file_req[i] = req;
+		req_put(mtpg, &mtpg->tx_file_idle, req);
+	}
+
 	rc = -ENOMEM;
 
 	if (gadget_is_dualspeed(cdev->gadget)) {
@@ -1087,6 +1522,7 @@ static void mtpg_function_disable(struct usb_function *f)
 	dev->bulk_out->driver_data = NULL;
 
 	wake_up(&dev->read_wq);
+	wake_up(&dev->write_wq);
 }
 
 
@@ -1116,6 +1552,12 @@ static void mtp_complete_cancel_io(struct usb_ep *ep,
 		/*Debugging*/
 		for(i=0;i<USB_PTPREQUEST_CANCELIO_SIZE; i++)
 			DEBUG_MTPB("[%s] cancel_io_buf[%d] = %x \tline = [%d] \n", __func__,i,dev->cancel_io_buf[i],__LINE__);
+
+		/* abort a file transfer running in the ioctl */
+		dev->xfer_cancel = 1;
+		wake_up(&dev->read_wq);
+		wake_up(&dev->write_wq);
+
 		mtp_send_signal(USB_PTPREQUEST_CANCELIO);
 	}
 
@@ -1220,10 +1662,14 @@ int __init mtp_function_add(struct usb_configuration *c)
 	atomic_set(&mtpg->read_excl, 0);
 	atomic_set(&mtpg->write_excl, 0);
 	atomic_set(&mtpg->wintfd_excl, 0);
+	atomic_set(&mtpg->rx_queued, 0);
 
 	INIT_LIST_HEAD(&mtpg->rx_idle);
 	INIT_LIST_HEAD(&mtpg->rx_done);
 	INIT_LIST_HEAD(&mtpg->tx_idle);
+	INIT_LIST_HEAD(&mtpg->tx_file_idle);
+	INIT_LIST_HEAD(&mtpg->rx_file_idle);
+	INIT_LIST_HEAD(&mtpg->rx_file_done);
 
 	mtpg->function.name = longname;
 	mtpg->function.strings = dev_strings;
@@ -133,6 +133,21 @@ struct f_rndis {
 	atomic_t			notify_count;
 };
 
+/* RNDIS lets one USB transfer carry several packet messages, which
+ * cuts the per-packet USB overhead at high packet rates.  Host-to-device
+ * is bounded by what we advertise, device-to-host additionally by the
+ * MaxTransferSize the host sends in its INITIALIZE message.
+ */
+static unsigned int rndis_ul_max_pkt_per_xfer = 3;
+module_param(rndis_ul_max_pkt_per_xfer, uint, S_IRUGO);
+MODULE_PARM_DESC(rndis_ul_max_pkt_per_xfer,
+	"max RNDIS packets per transfer from the host");
+
+static unsigned int rndis_dl_max_pkt_per_xfer = 8;
+module_param(rndis_dl_max_pkt_per_xfer, uint, S_IRUGO);
+MODULE_PARM_DESC(rndis_dl_max_pkt_per_xfer,
+	"max RNDIS packets per transfer to the host");
+
 static inline struct f_rndis *func_to_rndis(struct usb_function *f)
 {
 	return container_of(f, struct f_rndis, port.func);
@@ -377,14 +392,13 @@ static struct usb_ether_platform_data *rndis_pdata;
 static struct sk_buff *rndis_add_header(struct gether *port,
 					struct sk_buff *skb)
 {
-	struct sk_buff *skb2;
-
-	skb2 = skb_realloc_headroom(skb, sizeof(struct rndis_packet_msg_type));
-	if (skb2)
-		rndis_add_hdr(skb2);
-
-	dev_kfree_skb_any(skb);
-	return skb2;
+	/* only copy the frame when there's no room for the header */
+	if (skb_cow_head(skb, sizeof(struct rndis_packet_msg_type))) {
+		dev_kfree_skb_any(skb);
+		return NULL;
+	}
+	rndis_add_hdr(skb);
+	return skb;
 }
 
 static void rndis_response_available(void *_rndis)
@@ -475,6 +489,10 @@ static void rndis_command_complete(struct usb_ep *ep, struct usb_request *req)
 		ERROR(cdev, "RNDIS command error %d, %d/%d\n",
 			status, req->actual, req->length);
 
+	/* the host may have (re)announced its MaxTransferSize */
+	rndis->port.dl_max_xfer_size =
+		rndis_get_dl_max_xfer_size(rndis->config);
+
 	CSY_DBG("rndis_command_complete req->length=0x%x\n", req->length);
 //	spin_unlock(&dev->lock);
 }
@@ -808,6 +826,8 @@ rndis_bind(struct usb_configuration *c, struct usb_function *f)
 
 	rndis_set_param_medium(rndis->config, NDIS_MEDIUM_802_3, 0);
 	rndis_set_host_mac(rndis->config, rndis->ethaddr);
+	rndis_set_max_pkt_xfer(rndis->config,
+			rndis->port.ul_max_pkts_per_xfer);
 
 #ifdef CONFIG_USB_ANDROID_RNDIS
 	if (rndis_pdata) {
@@ -1014,6 +1034,10 @@ rndis_bind_config(struct usb_configuration *c, u8 ethaddr[ETH_ALEN])
 	rndis->port.header_len = sizeof(struct rndis_packet_msg_type);
 	rndis->port.wrap = rndis_add_header;
 	rndis->port.unwrap = rndis_rm_hdr;
+	rndis->port.ul_max_pkts_per_xfer = clamp_t(u32,
+			rndis_ul_max_pkt_per_xfer, 1, RNDIS_MAX_PKTS_PER_XFER);
+	rndis->port.dl_max_pkts_per_xfer = clamp_t(u32,
+			rndis_dl_max_pkt_per_xfer, 1, RNDIS_MAX_PKTS_PER_XFER);
 
 	rndis->port.func.name = "rndis";
 	rndis->port.func.strings = rndis_strings;
@@ -576,6 +576,8 @@ static int rndis_init_response (int configNr, rndis_init_msg_type *buf)
 		return -ENOMEM;
 	resp = (rndis_init_cmplt_type *) r->buf;
 
+	params->dl_max_xfer_size = le32_to_cpu (buf->MaxTransferSize);
+
 	resp->MessageType = cpu_to_le32 (
 			REMOTE_NDIS_INITIALIZE_CMPLT);
 	resp->MessageLength = cpu_to_le32 (52);
@@ -585,13 +587,16 @@ static int rndis_init_response (int configNr, rndis_init_msg_type *buf)
 	resp->MinorVersion = cpu_to_le32 (RNDIS_MINOR_VERSION);
 	resp->DeviceFlags = cpu_to_le32 (RNDIS_DF_CONNECTIONLESS);
 	resp->Medium = cpu_to_le32 (RNDIS_MEDIUM_802_3);
-	resp->MaxPacketsPerTransfer = cpu_to_le32 (1);
-	resp->MaxTransferSize = cpu_to_le32 (
+	resp->MaxPacketsPerTransfer = cpu_to_le32 (params->max_pkt_per_xfer);
+	resp->MaxTransferSize = cpu_to_le32 (params->max_pkt_per_xfer * (
 		  params->dev->mtu
 		+ sizeof (struct ethhdr)
 		+ sizeof (struct rndis_packet_msg_type)
-		+ 22);
-	resp->PacketAlignmentFactor = cpu_to_le32 (0);
+		+ 22));
+	/* with several messages per transfer, have each start 4-byte
+	 * aligned so the IP headers behind them stay aligned too */
+	resp->PacketAlignmentFactor = cpu_to_le32 (
+		params->max_pkt_per_xfer > 1 ? 2 : 0);
 	resp->AFListOffset = cpu_to_le32 (0);
 	resp->AFListSize = cpu_to_le32 (0);
 
@@ -902,6 +907,7 @@ int rndis_register(void (*resp_avail)(void *v), void *v)
 	for (i = 0; i < RNDIS_MAX_CONFIGS; i++) {
 		if (!rndis_per_dev_params [i].used) {
 			rndis_per_dev_params [i].used = 1;
+			rndis_per_dev_params [i].max_pkt_per_xfer = 1;
 			rndis_per_dev_params [i].resp_avail = resp_avail;
 			rndis_per_dev_params [i].v = v;
 			pr_debug("%s: configNr = %d\n", __func__, i);
@@ -959,6 +965,22 @@ int rndis_set_param_medium (u8 configNr, u32 medium, u32 speed)
 	return 0;
 }
 
+void rndis_set_max_pkt_xfer(u8 configNr, u32 max_pkt_per_xfer)
+{
+	pr_debug("%s: %u\n", __func__, max_pkt_per_xfer);
+	if (configNr >= RNDIS_MAX_CONFIGS) return;
+
+	rndis_per_dev_params [configNr].max_pkt_per_xfer = clamp_t(u32,
+		max_pkt_per_xfer, 1, RNDIS_MAX_PKTS_PER_XFER);
+}
+
+u32 rndis_get_dl_max_xfer_size(u8 configNr)
+{
+	if (configNr >= RNDIS_MAX_CONFIGS) return 0;
+
+	return rndis_per_dev_params [configNr].dl_max_xfer_size;
+}
+
 void rndis_add_hdr (struct sk_buff *skb)
 {
 	struct rndis_packet_msg_type	*header;
@@ -1027,30 +1049,67 @@ static rndis_resp_t *rndis_add_response (int configNr, u32 length)
 	return r;
 }
 
+/*
+ * One transfer may carry several RNDIS_PACKET_MSGs when the host was
+ * told so in the INITIALIZE reply; all but the last become clones
+ * sharing the transfer's buffer.  Anything after the last message
+ * too short to be one is the host's padding.
+ */
 int rndis_rm_hdr(struct gether *port,
 			struct sk_buff *skb,
 			struct sk_buff_head *list)
 {
-	/* tmp points to a struct rndis_packet_msg_type */
-	__le32		*tmp = (void *) skb->data;
+	struct sk_buff	*skb2;
+	int		queued = 0;
+	int		status;
+
+	for (;;) {
+		/* tmp points to a struct rndis_packet_msg_type */
+		__le32		*tmp = (void *) skb->data;
+		u32		msg_len, data_offset, data_len;
+
+		/* MessageType, MessageLength */
+		if (skb->len < sizeof (struct rndis_packet_msg_type)
+				|| cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
+					!= get_unaligned(tmp++)) {
+			status = -EINVAL;
+			goto fail;
+		}
+		msg_len = get_unaligned_le32(tmp++);
+
+		/* DataOffset, DataLength */
+		data_offset = get_unaligned_le32(tmp++) + 8;
+		data_len = get_unaligned_le32(tmp++);
+		if (msg_len > skb->len || data_offset > msg_len
+				|| data_len > msg_len - data_offset) {
+			status = -EOVERFLOW;
+			goto fail;
+		}
 
-	/* MessageType, MessageLength */
-	if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
-			!= get_unaligned(tmp++)) {
-		dev_kfree_skb_any(skb);
-		return -EINVAL;
-	}
-	tmp++;
+		if (skb->len - msg_len < sizeof (struct rndis_packet_msg_type)) {
+			skb_pull(skb, data_offset);
+			skb_trim(skb, data_len);
+			skb_queue_tail(list, skb);
+			return 0;
+		}
 
-	/* DataOffset, DataLength */
-	if (!skb_pull(skb, get_unaligned_le32(tmp++) + 8)) {
-		dev_kfree_skb_any(skb);
-		return -EOVERFLOW;
+		skb2 = skb_clone(skb, GFP_ATOMIC);
+		if (!skb2) {
+			status = -ENOMEM;
+			goto fail;
+		}
+		skb_pull(skb2, data_offset);
+		skb_trim(skb2, data_len);
+		skb_queue_tail(list, skb2);
+		queued++;
+
+		skb_pull(skb, msg_len);
 	}
-	skb_trim(skb, get_unaligned_le32(tmp++));
 
-	skb_queue_tail(list, skb);
-	return 0;
+fail:
+	dev_kfree_skb_any(skb);
+	/* don't have u_ether throw away the messages already split off */
+	return queued ? 0 : status;
 }
 
 #ifdef	CONFIG_USB_GADGET_DEBUG_FILES
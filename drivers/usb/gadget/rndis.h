@@ -20,6 +20,9 @@
 #define RNDIS_MAXIMUM_FRAME_SIZE	1518
 #define RNDIS_MAX_TOTAL_SIZE		1558
 
+/* Most RNDIS packet messages we put in, or accept in, one USB transfer */
+#define RNDIS_MAX_PKTS_PER_XFER		16
+
 /* Remote NDIS Versions */
 #define RNDIS_MAJOR_VERSION		1
 #define RNDIS_MINOR_VERSION		0
@@ -236,6 +239,12 @@ typedef struct rndis_params
 
 	u32			vendorID;
 	const char		*vendorDescr;
+
+	/* RNDIS messages per USB transfer we accept from the host,
+	 * and the largest transfer the host accepts from us */
+	u32			max_pkt_per_xfer;
+	u32			dl_max_xfer_size;
+
 	void			(*resp_avail)(void *v);
 	void			*v;
 	struct list_head	resp_queue;
@@ -250,6 +259,8 @@ int  rndis_set_param_dev (u8 configNr, struct net_device *dev,
 int  rndis_set_param_vendor (u8 configNr, u32 vendorID,
 			    const char *vendorDescr);
 int  rndis_set_param_medium (u8 configNr, u32 medium, u32 speed);
+void rndis_set_max_pkt_xfer(u8 configNr, u32 max_pkt_per_xfer);
+u32  rndis_get_dl_max_xfer_size(u8 configNr);
 void rndis_add_hdr (struct sk_buff *skb);
 int rndis_rm_hdr(struct gether *port, struct sk_buff *skb,
 			struct sk_buff_head *list);
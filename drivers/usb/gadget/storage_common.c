@@ -290,10 +290,18 @@ static struct fsg_lun *fsg_lun_from_dev(struct device *dev)
 #define DELAYED_STATUS	(EP0_BUFSIZE + 999)	/* An impossibly large value */
 
 /* Number of buffers we will use.  2 is enough for double-buffering */
+#ifdef CONFIG_USB_GADGET_STORAGE_NUM_BUFFERS
+#define FSG_NUM_BUFFERS	CONFIG_USB_GADGET_STORAGE_NUM_BUFFERS
+#else
 #define FSG_NUM_BUFFERS	2
+#endif
 
 /* Default size of buffer length. */
+#ifdef CONFIG_USB_GADGET_STORAGE_BUFLEN_KB
+#define FSG_BUFLEN	((u32)CONFIG_USB_GADGET_STORAGE_BUFLEN_KB * 1024)
+#else
 #define FSG_BUFLEN	((u32)16384)
+#endif
 
 /* Maximal number of LUNs supported in mass storage function */
 #define FSG_MAX_LUNS	8
@@ -620,6 +628,11 @@ static int fsg_lun_open(struct fsg_lun *curlun, const char *filename)
 		goto out;
 	}
 
+	/* Let the page cache read ahead at least as far as the whole
+	 * buffer pipeline, so the backing device stays ahead of USB. */
+	filp->f_ra.ra_pages = max_t(unsigned long, filp->f_ra.ra_pages,
+			(FSG_NUM_BUFFERS * FSG_BUFLEN) >> PAGE_SHIFT);
+
 	get_file(filp);
 	curlun->ro = ro;
 	curlun->filp = filp;
@@ -69,6 +69,11 @@ struct eth_dev {
 	struct list_head	tx_reqs, rx_reqs;
 	atomic_t		tx_qlen;
 
+	/* device-to-host aggregation, see tx_agg_xmit() */
+	bool			tx_agg;
+	struct usb_request	*tx_agg_req;	/* being filled, not queued */
+	unsigned		tx_agg_count;
+
 	struct sk_buff_head	rx_frames;
 
 	unsigned		header_len;
@@ -92,6 +97,8 @@ struct eth_dev {
 
 #define DEFAULT_QLEN	2	/* double buffering by default */
 
+#define TX_AGG_BUF_SIZE	16384	/* per request, when aggregating */
+
 
 #ifdef CONFIG_USB_GADGET_DUALSPEED
 
@@ -237,6 +244,8 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 */
 	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
 	size += dev->port_usb->header_len;
+	if (dev->port_usb->ul_max_pkts_per_xfer > 1)
+		size *= dev->port_usb->ul_max_pkts_per_xfer;
 	size += out->maxpacket - 1;
 	size -= size % out->maxpacket;
 
@@ -501,6 +510,203 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 		netif_wake_queue(dev->net);
 }
 
+/*
+ * With a framing that allows several packets per transfer, each tx
+ * request owns a TX_AGG_BUF_SIZE buffer that frames are copied into.
+ * A frame is sent at once while the IN endpoint is idle; while it is
+ * busy, frames collect in dev->tx_agg_req until that is full or the
+ * next completion comes in.  So the batch size adapts to the load
+ * without adding latency to a lightly used link.
+ */
+static int tx_agg_alloc(struct eth_dev *dev)
+{
+	struct usb_request	*req, *r;
+
+	spin_lock(&dev->req_lock);
+	list_for_each_entry(req, &dev->tx_reqs, list) {
+		req->buf = kmalloc(TX_AGG_BUF_SIZE, GFP_ATOMIC);
+		if (!req->buf)
+			goto fail;
+	}
+	spin_unlock(&dev->req_lock);
+	return 0;
+
+fail:
+	list_for_each_entry(r, &dev->tx_reqs, list) {
+		if (r == req)
+			break;
+		kfree(r->buf);
+		r->buf = NULL;
+	}
+	spin_unlock(&dev->req_lock);
+	return -ENOMEM;
+}
+
+static void tx_agg_complete(struct usb_ep *ep, struct usb_request *req);
+
+/* the caller already counted req in tx_qlen */
+static void tx_agg_queue(struct eth_dev *dev, struct usb_ep *in,
+		struct usb_request *req, unsigned count)
+{
+	unsigned long	flags;
+	int		retval;
+
+	req->context = (void *) (unsigned long) count;
+	req->complete = tx_agg_complete;
+	req->no_interrupt = 0;
+
+	/* TX_AGG_BUF_SIZE leaves room for the extra byte */
+	req->zero = dev->zlp;
+	if (!dev->zlp && req->length % in->maxpacket == 0)
+		req->length++;
+
+	retval = usb_ep_queue(in, req, GFP_ATOMIC);
+	if (retval) {
+		DBG(dev, "tx queue err %d\n", retval);
+		dev->net->stats.tx_dropped += count;
+		atomic_dec(&dev->tx_qlen);
+
+		spin_lock_irqsave(&dev->req_lock, flags);
+		if (list_empty(&dev->tx_reqs))
+			netif_start_queue(dev->net);
+		list_add(&req->list, &dev->tx_reqs);
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+	} else {
+		dev->net->trans_start = jiffies;
+	}
+}
+
+static void tx_agg_complete(struct usb_ep *ep, struct usb_request *req)
+{
+	struct eth_dev		*dev = ep->driver_data;
+	unsigned		count = (unsigned long) req->context;
+	struct usb_request	*next = NULL;
+	unsigned		next_count = 0;
+
+	switch (req->status) {
+	default:
+		dev->net->stats.tx_errors++;
+		VDBG(dev, "tx err %d\n", req->status);
+		/* FALLTHROUGH */
+	case -ECONNRESET:		/* unlink */
+	case -ESHUTDOWN:		/* disconnect etc */
+		break;
+	case 0:
+		dev->net->stats.tx_bytes += req->actual
+				- count * dev->header_len;
+	}
+	dev->net->stats.tx_packets += count;
+
+	spin_lock(&dev->req_lock);
+	list_add(&req->list, &dev->tx_reqs);
+
+	/* send whatever was batched up while this one was in flight */
+	if (req->status != -ESHUTDOWN && dev->tx_agg_req) {
+		next = dev->tx_agg_req;
+		next_count = dev->tx_agg_count;
+		dev->tx_agg_req = NULL;
+		atomic_inc(&dev->tx_qlen);
+	}
+	spin_unlock(&dev->req_lock);
+
+	atomic_dec(&dev->tx_qlen);
+	if (next)
+		tx_agg_queue(dev, ep, next, next_count);
+
+	if (netif_carrier_ok(dev->net))
+		netif_wake_queue(dev->net);
+}
+
+static netdev_tx_t tx_agg_xmit(struct eth_dev *dev, struct sk_buff *skb,
+		struct usb_ep *in)
+{
+	struct net_device	*net = dev->net;
+	struct usb_request	*req, *full = NULL, *now = NULL;
+	unsigned		full_count = 0, now_count = 0;
+	u32			limit = TX_AGG_BUF_SIZE - 1;
+	u32			max_pkts = 1;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->port_usb) {
+		struct gether	*port = dev->port_usb;
+
+		if (port->dl_max_xfer_size) {
+			limit = min(limit, port->dl_max_xfer_size);
+			max_pkts = port->dl_max_pkts_per_xfer;
+		}
+		if (dev->wrap)
+			skb = dev->wrap(port, skb);
+	} else {
+		dev_kfree_skb_any(skb);
+		skb = NULL;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (!skb)
+		goto drop;
+	if (skb->len > TX_AGG_BUF_SIZE - 1) {
+		dev_kfree_skb_any(skb);
+		goto drop;
+	}
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	req = dev->tx_agg_req;
+	if (req && req->length + skb->len > limit) {
+		full = req;
+		full_count = dev->tx_agg_count;
+		atomic_inc(&dev->tx_qlen);
+		req = NULL;
+	}
+	if (!req) {
+		/* only when racing with disconnect(), see below */
+		if (list_empty(&dev->tx_reqs)) {
+			dev->tx_agg_req = NULL;
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			dev_kfree_skb_any(skb);
+			if (full)
+				tx_agg_queue(dev, in, full, full_count);
+			goto drop;
+		}
+		req = container_of(dev->tx_reqs.next,
+				struct usb_request, list);
+		list_del(&req->list);
+		req->length = 0;
+		dev->tx_agg_count = 0;
+	}
+
+	memcpy(req->buf + req->length, skb->data, skb->len);
+	req->length += skb->len;
+	dev->tx_agg_count++;
+	dev->tx_agg_req = req;
+
+	if (dev->tx_agg_count >= max_pkts
+			|| req->length + ETH_FRAME_LEN + dev->header_len > limit
+			|| atomic_read(&dev->tx_qlen) == 0) {
+		now = req;
+		now_count = dev->tx_agg_count;
+		dev->tx_agg_req = NULL;
+		atomic_inc(&dev->tx_qlen);
+	}
+
+	/* stop once the next frame would need a request we don't have */
+	if (list_empty(&dev->tx_reqs) && !dev->tx_agg_req)
+		netif_stop_queue(net);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	dev_kfree_skb_any(skb);
+
+	if (full)
+		tx_agg_queue(dev, in, full, full_count);
+	if (now)
+		tx_agg_queue(dev, in, now, now_count);
+	return NETDEV_TX_OK;
+
+drop:
+	net->stats.tx_dropped++;
+	return NETDEV_TX_OK;
+}
+
 static inline int is_promisc(u16 cdc_filter)
 {
 	return cdc_filter & USB_CDC_PACKET_TYPE_PROMISCUOUS;
@@ -554,6 +760,9 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		/* ignores USB_CDC_PACKET_TYPE_DIRECTED */
 	}
 
+	if (dev->tx_agg)
+		return tx_agg_xmit(dev, skb, in);
+
 	spin_lock_irqsave(&dev->req_lock, flags);
 	/*
 	 * this freelist can be empty if an interrupt triggered disconnect()
@@ -937,6 +1146,13 @@ struct net_device *gether_connect(struct gether *link)
 		dev->unwrap = link->unwrap;
 		dev->wrap = link->wrap;
 
+		/* falls back to one frame per request if the
+		 * aggregation buffers can't be had
+		 */
+		dev->tx_agg = link->dl_max_pkts_per_xfer > 1
+				&& tx_agg_alloc(dev) == 0;
+		dev->tx_agg_req = NULL;
+
 		spin_lock(&dev->lock);
 		dev->port_usb = link;
 		link->ioport = dev;
@@ -997,15 +1213,23 @@ void gether_disconnect(struct gether *link)
 	 */
 	usb_ep_disable(link->in_ep);
 	spin_lock(&dev->req_lock);
+	if (dev->tx_agg_req) {
+		dev->net->stats.tx_dropped += dev->tx_agg_count;
+		list_add(&dev->tx_agg_req->list, &dev->tx_reqs);
+		dev->tx_agg_req = NULL;
+	}
 	while (!list_empty(&dev->tx_reqs)) {
 		req = container_of(dev->tx_reqs.next,
 					struct usb_request, list);
 		list_del(&req->list);
 
 		spin_unlock(&dev->req_lock);
+		if (dev->tx_agg)
+			kfree(req->buf);
 		usb_ep_free_request(link->in_ep, req);
 		spin_lock(&dev->req_lock);
 	}
+	dev->tx_agg = false;
 	spin_unlock(&dev->req_lock);
 	link->in_ep->driver_data = NULL;
 	link->in = NULL;
@@ -68,6 +68,14 @@ struct gether {
 						struct sk_buff *skb,
 						struct sk_buff_head *list);
 
+	/* framings that can carry several packets per transfer (RNDIS)
+	 * set these; dl is device-to-host, ul host-to-device.  A zero
+	 * dl_max_xfer_size means the host hasn't told us its limit.
+	 */
+	u32				dl_max_pkts_per_xfer;
+	u32				dl_max_xfer_size;
+	u32				ul_max_pkts_per_xfer;
+
 	/* called on network open/close */
 	void				(*open)(struct gether *);
 	void				(*close)(struct gether *);
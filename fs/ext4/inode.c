@@ -5244,10 +5244,12 @@ static int ext4_inode_blocks_set(handle_t *handle,
  * buffer_head in the inode location struct.
  *
  * The caller must have write access to iloc->bh.
+ *
+ * A lazy update doesn't make fsync() wait for this transaction.
  */
 static int ext4_do_update_inode(handle_t *handle,
 				struct inode *inode,
-				struct ext4_iloc *iloc)
+				struct ext4_iloc *iloc, int lazy)
 {
 	struct ext4_inode *raw_inode = ext4_raw_inode(iloc);
 	struct ext4_inode_info *ei = EXT4_I(inode);
@@ -5354,7 +5356,8 @@ static int ext4_do_update_inode(handle_t *handle,
 		err = rc;
 	ext4_clear_inode_state(inode, EXT4_STATE_NEW);
 
-	ext4_update_inode_fsync_trans(handle, inode, 0);
+	if (!lazy)
+		ext4_update_inode_fsync_trans(handle, inode, 0);
 out_brelse:
 	brelse(bh);
 	ext4_std_error(inode->i_sb, err);
@@ -5718,8 +5721,8 @@ int ext4_chunk_trans_blocks(struct inode *inode, int nrblocks)
  * The caller must have previously called ext4_reserve_inode_write().
  * Give this, we know that the caller already has write access to iloc->bh.
  */
-int ext4_mark_iloc_dirty(handle_t *handle,
-			 struct inode *inode, struct ext4_iloc *iloc)
+static int __ext4_mark_iloc_dirty(handle_t *handle, struct inode *inode,
+				  struct ext4_iloc *iloc, int lazy)
 {
 	int err = 0;
 
@@ -5730,11 +5733,17 @@ int ext4_mark_iloc_dirty(handle_t *handle,
 	get_bh(iloc->bh);
 
 	/* ext4_do_update_inode() does jbd2_journal_dirty_metadata */
-	err = ext4_do_update_inode(handle, inode, iloc);
+	err = ext4_do_update_inode(handle, inode, iloc, lazy);
 	put_bh(iloc->bh);
 	return err;
 }
 
+int ext4_mark_iloc_dirty(handle_t *handle,
+			 struct inode *inode, struct ext4_iloc *iloc)
+{
+	return __ext4_mark_iloc_dirty(handle, inode, iloc, 0);
+}
+
 /*
  * On success, We end up with an outstanding reference count against
  * iloc->bh.  This _must_ be cleaned up later.
@@ -5813,7 +5822,8 @@ static int ext4_expand_extra_isize(struct inode *inode,
  * to do a write_super() to free up some memory.  It has the desired
  * effect.
  */
-int ext4_mark_inode_dirty(handle_t *handle, struct inode *inode)
+static int __ext4_mark_inode_dirty(handle_t *handle, struct inode *inode,
+				   int lazy)
 {
 	struct ext4_iloc iloc;
 	struct ext4_sb_info *sbi = EXT4_SB(inode->i_sb);
@@ -5853,10 +5863,15 @@ int ext4_mark_inode_dirty(handle_t *handle, struct inode *inode)
 		}
 	}
 	if (!err)
-		err = ext4_mark_iloc_dirty(handle, inode, &iloc);
+		err = __ext4_mark_iloc_dirty(handle, inode, &iloc, lazy);
 	return err;
 }
 
+int ext4_mark_inode_dirty(handle_t *handle, struct inode *inode)
+{
+	return __ext4_mark_inode_dirty(handle, inode, 0);
+}
+
 /*
  * ext4_dirty_inode() is called from __mark_inode_dirty()
  *
@@ -5873,13 +5888,20 @@ int ext4_mark_inode_dirty(handle_t *handle, struct inode *inode)
  */
 void ext4_dirty_inode(struct inode *inode)
 {
-	handle_t *handle;
+	handle_t *handle, *current_handle = ext4_journal_current_handle();
 
 	handle = ext4_journal_start(inode, 2);
 	if (IS_ERR(handle))
 		goto out;
 
-	ext4_mark_inode_dirty(handle, inode);
+	/*
+	 * With lazy_fsync, updates the VFS asks for on its own (timestamps,
+	 * mostly) don't make fsync() force a commit, so for those fsync()
+	 * behaves like fdatasync().  Changes made inside an ext4 handle are
+	 * journalled and waited for as usual.
+	 */
+	__ext4_mark_inode_dirty(handle, inode,
+			!current_handle && test_opt(inode->i_sb, LAZY_FSYNC));
 
 	ext4_journal_stop(handle);
 out:
@@ -13,10 +13,15 @@
 #include <linux/buffer_head.h>
 #include "fat.h"
 
-/* this must be > 0. */
-#define FAT_MAX_CACHE	8
+/*
+ * this must be > 0.  The extents of an inode are kept in an rbtree sorted
+ * by file cluster, so lookups stay cheap with many of them; the LRU list
+ * only picks the one to reuse once the limit is reached.
+ */
+#define FAT_MAX_CACHE	256
 
 struct fat_cache {
+	struct rb_node rb_node;
 	struct list_head cache_list;
 	int nr_contig;	/* number of contiguous clusters */
 	int fcluster;	/* cluster number in the file. */
@@ -82,25 +87,27 @@ static int fat_cache_lookup(struct inode *inode, int fclus,
 			    struct fat_cache_id *cid,
 			    int *cached_fclus, int *cached_dclus)
 {
-	static struct fat_cache nohit = { .fcluster = 0, };
-
-	struct fat_cache *hit = &nohit, *p;
+	struct rb_node *n;
+	struct fat_cache *hit = NULL, *p;
 	int offset = -1;
 
 	spin_lock(&MSDOS_I(inode)->cache_lru_lock);
-	list_for_each_entry(p, &MSDOS_I(inode)->cache_lru, cache_list) {
-		/* Find the cache of "fclus" or nearest cache. */
-		if (p->fcluster <= fclus && hit->fcluster < p->fcluster) {
+	/* Find the cache of "fclus" or nearest cache before it. */
+	n = MSDOS_I(inode)->cache_tree.rb_node;
+	while (n) {
+		p = rb_entry(n, struct fat_cache, rb_node);
+		if (p->fcluster <= fclus) {
 			hit = p;
-			if ((hit->fcluster + hit->nr_contig) < fclus) {
-				offset = hit->nr_contig;
-			} else {
-				offset = fclus - hit->fcluster;
-				break;
-			}
-		}
+			n = n->rb_right;
+		} else
+			n = n->rb_left;
 	}
-	if (hit != &nohit) {
+	if (hit != NULL) {
+		if ((hit->fcluster + hit->nr_contig) < fclus)
+			offset = hit->nr_contig;
+		else
+			offset = fclus - hit->fcluster;
+
 		fat_cache_update_lru(inode, hit);
 
 		cid->id = MSDOS_I(inode)->cache_valid_id;
@@ -118,11 +125,17 @@ static int fat_cache_lookup(struct inode *inode, int fclus,
 static struct fat_cache *fat_cache_merge(struct inode *inode,
 					 struct fat_cache_id *new)
 {
+	struct rb_node *n = MSDOS_I(inode)->cache_tree.rb_node;
 	struct fat_cache *p;
 
-	list_for_each_entry(p, &MSDOS_I(inode)->cache_lru, cache_list) {
+	while (n) {
+		p = rb_entry(n, struct fat_cache, rb_node);
 		/* Find the same part as "new" in cluster-chain. */
-		if (p->fcluster == new->fcluster) {
+		if (new->fcluster < p->fcluster)
+			n = n->rb_left;
+		else if (new->fcluster > p->fcluster)
+			n = n->rb_right;
+		else {
 			BUG_ON(p->dcluster != new->dcluster);
 			if (new->nr_contig > p->nr_contig)
 				p->nr_contig = new->nr_contig;
@@ -132,6 +145,25 @@ static struct fat_cache *fat_cache_merge(struct inode *inode,
 	return NULL;
 }
 
+/* The caller has checked with fat_cache_merge() that fcluster isn't there */
+static void fat_cache_insert(struct inode *inode, struct fat_cache *cache)
+{
+	struct rb_node **n = &MSDOS_I(inode)->cache_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct fat_cache *p;
+
+	while (*n) {
+		parent = *n;
+		p = rb_entry(parent, struct fat_cache, rb_node);
+		if (cache->fcluster < p->fcluster)
+			n = &parent->rb_left;
+		else
+			n = &parent->rb_right;
+	}
+	rb_link_node(&cache->rb_node, parent, n);
+	rb_insert_color(&cache->rb_node, &MSDOS_I(inode)->cache_tree);
+}
+
 static void fat_cache_add(struct inode *inode, struct fat_cache_id *new)
 {
 	struct fat_cache *cache, *tmp;
@@ -162,10 +194,12 @@ static void fat_cache_add(struct inode *inode, struct fat_cache_id *new)
 		} else {
 			struct list_head *p = MSDOS_I(inode)->cache_lru.prev;
 			cache = list_entry(p, struct fat_cache, cache_list);
+			rb_erase(&cache->rb_node, &MSDOS_I(inode)->cache_tree);
 		}
 		cache->fcluster = new->fcluster;
 		cache->dcluster = new->dcluster;
 		cache->nr_contig = new->nr_contig;
+		fat_cache_insert(inode, cache);
 	}
 out_update_lru:
 	fat_cache_update_lru(inode, cache);
@@ -185,6 +219,7 @@ static void __fat_cache_inval_inode(struct inode *inode)
 	while (!list_empty(&i->cache_lru)) {
 		cache = list_entry(i->cache_lru.next, struct fat_cache, cache_list);
 		list_del_init(&cache->cache_list);
+		rb_erase(&cache->rb_node, &i->cache_tree);
 		i->nr_caches--;
 		fat_cache_free(cache);
 	}
@@ -250,6 +285,7 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 			goto out;
 		}
 
+		fat_ent_reada_chain(sb, *dclus);
 		nr = fat_ent_read(inode, &fatent, *dclus);
 		if (nr < 0)
 			goto out;
@@ -265,8 +301,12 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 		}
 		(*fclus)++;
 		*dclus = nr;
-		if (!cache_contiguous(&cid, *dclus))
+		if (!cache_contiguous(&cid, *dclus)) {
+			/* Keep the run that just ended for later lookups. */
+			cid.nr_contig--;
+			fat_cache_add(inode, &cid);
 			cache_init(&cid, *fclus, *dclus);
+		}
 	}
 	nr = 0;
 	fat_cache_add(inode, &cid);
@@ -7,6 +7,7 @@
 #include <linux/fs.h>
 #include <linux/mutex.h>
 #include <linux/ratelimit.h>
+#include <linux/rbtree.h>
 #include <linux/msdos_fs.h>
 
 /*
@@ -84,6 +85,10 @@ struct msdos_sb_info {
 	struct fatent_operations *fatent_ops;
 	struct inode *fat_inode;
 
+	/* FAT blocks already read ahead for cluster chain walks */
+	sector_t chain_reada_start;
+	sector_t chain_reada_end;
+
 	struct ratelimit_state ratelimit;
 
 	spinlock_t inode_hash_lock;
@@ -98,12 +103,14 @@ struct msdos_sb_info {
 struct msdos_inode_info {
 	spinlock_t cache_lru_lock;
 	struct list_head cache_lru;
+	struct rb_root cache_tree;	/* extents sorted by file cluster */
 	int nr_caches;
 	/* for avoiding the race between fat_free() and fat_get_cluster() */
 	unsigned int cache_valid_id;
 
 	/* NOTE: mmu_private is 64bits, so must hold ->i_mutex to access */
 	loff_t mmu_private;	/* physically allocated size */
+	loff_t alloc_end;	/* end of the write in progress */
 
 	int i_start;		/* first cluster or 0 */
 	int i_logstart;		/* logical first cluster */
@@ -294,6 +301,7 @@ static inline void fatent_brelse(struct fat_entry *fatent)
 extern void fat_ent_access_init(struct super_block *sb);
 extern int fat_ent_read(struct inode *inode, struct fat_entry *fatent,
 			int entry);
+extern void fat_ent_reada_chain(struct super_block *sb, int entry);
 extern int fat_ent_write(struct inode *inode, struct fat_entry *fatent,
 			 int new, int wait);
 extern int fat_alloc_clusters(struct inode *inode, int *cluster,
@@ -638,6 +638,34 @@ static void fat_ent_reada(struct super_block *sb, struct fat_entry *fatent,
 		sb_breadahead(sb, blocknr + i);
 }
 
+/*
+ * Read ahead the FAT blocks from the one holding "entry", unless it's in
+ * the window read ahead last time.  Walking a long cluster chain then
+ * reads the FAT in FAT_READA_SIZE requests rather than block by block.
+ * The window is only a hint, so it isn't locked.
+ */
+void fat_ent_reada_chain(struct super_block *sb, int entry)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	struct fatent_operations *ops = sbi->fatent_ops;
+	unsigned long reada_blocks = FAT_READA_SIZE >> sb->s_blocksize_bits;
+	sector_t blocknr, fat_end = sbi->fat_start + sbi->fat_length;
+	int offset;
+
+	ops->ent_blocknr(sb, entry, &offset, &blocknr);
+	if (blocknr >= sbi->chain_reada_start &&
+	    blocknr < sbi->chain_reada_end)
+		return;
+
+	if (reada_blocks > fat_end - blocknr)
+		reada_blocks = fat_end - blocknr;
+
+	sbi->chain_reada_start = blocknr;
+	sbi->chain_reada_end = blocknr + reada_blocks;
+	while (blocknr < sbi->chain_reada_end)
+		sb_breadahead(sb, blocknr++);
+}
+
 int fat_count_free_clusters(struct super_block *sb)
 {
 	struct msdos_sb_info *sbi = MSDOS_SB(sb);
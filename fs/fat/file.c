@@ -161,12 +161,50 @@ int fat_file_fsync(struct file *filp, int datasync)
 }
 
 
+/*
+ * Tell fat_get_block() how far this write goes, so the clusters for it
+ * are allocated as one run.  Whatever a short write didn't fill is given
+ * back before i_mutex is dropped.
+ */
+static ssize_t fat_file_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file->f_mapping->host;
+	struct msdos_sb_info *sbi = MSDOS_SB(inode->i_sb);
+	loff_t allocated;
+	ssize_t ret;
+
+	BUG_ON(iocb->ki_pos != pos);
+
+	mutex_lock(&inode->i_mutex);
+	MSDOS_I(inode)->alloc_end = iov_length(iov, nr_segs) +
+		((file->f_flags & O_APPEND) ? i_size_read(inode) : pos);
+	ret = __generic_file_aio_write(iocb, iov, nr_segs, &iocb->ki_pos);
+	MSDOS_I(inode)->alloc_end = 0;
+
+	allocated = (MSDOS_I(inode)->mmu_private + sbi->cluster_size - 1) &
+		~((loff_t)sbi->cluster_size - 1);
+	if (((loff_t)inode->i_blocks << 9) > allocated)
+		fat_truncate_blocks(inode, MSDOS_I(inode)->mmu_private);
+	mutex_unlock(&inode->i_mutex);
+
+	if (ret > 0 || ret == -EIOCBQUEUED) {
+		ssize_t err;
+
+		err = generic_write_sync(file, pos, ret);
+		if (err < 0 && ret > 0)
+			ret = err;
+	}
+	return ret;
+}
+
 const struct file_operations fat_file_operations = {
 	.llseek		= generic_file_llseek,
 	.read		= do_sync_read,
 	.write		= do_sync_write,
 	.aio_read	= generic_file_aio_read,
-	.aio_write	= generic_file_aio_write,
+	.aio_write	= fat_file_aio_write,
 	.mmap		= generic_file_mmap,
 	.release	= fat_file_release,
 	.unlocked_ioctl	= fat_generic_ioctl,
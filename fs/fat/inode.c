@@ -39,19 +39,56 @@ static int fat_default_codepage = CONFIG_FAT_DEFAULT_CODEPAGE;
 static char fat_default_iocharset[] = CONFIG_FAT_DEFAULT_IOCHARSET;
 
 
-static int fat_add_cluster(struct inode *inode)
+/* Upper limit of clusters allocated ahead for one write (in bytes) */
+#define FAT_ALLOC_AHEAD		(1 << 20)
+
+/*
+ * Add nr_cluster clusters to the end of the chain.  Only the first one
+ * is required, the rest is what the current write is going to fill, so
+ * running out of space there isn't an error.
+ */
+static int fat_add_cluster(struct inode *inode, int nr_cluster)
+{
+	int err = 0, nr, cluster[MAX_BUF_PER_PAGE / 2];
+	int added = 0;
+
+	while (added < nr_cluster) {
+		nr = min_t(int, nr_cluster - added, ARRAY_SIZE(cluster));
+		err = fat_alloc_clusters(inode, cluster, nr);
+		if (err == -ENOSPC && !added && nr > 1) {
+			nr_cluster = 1;
+			continue;
+		}
+		if (err)
+			break;
+		/* FIXME: this cluster should be added after data of this
+		 * cluster is writed */
+		err = fat_chain_add(inode, cluster[0], nr);
+		if (err) {
+			fat_free_clusters(inode, cluster[0]);
+			break;
+		}
+		added += nr;
+	}
+	return added ? 0 : err;
+}
+
+/*
+ * How many clusters to allocate at the end of the file.  A write() sets
+ * ->alloc_end, so the clusters it is going to fill are taken in one
+ * pass: they come out contiguous even with other files being written,
+ * and the FAT blocks are updated once per run instead of per cluster.
+ */
+static int fat_alloc_count(struct inode *inode)
 {
-	int err, cluster;
+	struct msdos_sb_info *sbi = MSDOS_SB(inode->i_sb);
+	loff_t end = MSDOS_I(inode)->alloc_end;
+	loff_t start = MSDOS_I(inode)->mmu_private;
 
-	err = fat_alloc_clusters(inode, &cluster, 1);
-	if (err)
-		return err;
-	/* FIXME: this cluster should be added after data of this
-	 * cluster is writed */
-	err = fat_chain_add(inode, cluster, 1);
-	if (err)
-		fat_free_clusters(inode, cluster);
-	return err;
+	if (end <= start)
+		return 1;
+	end = min_t(loff_t, end, start + FAT_ALLOC_AHEAD);
+	return (end - start + sbi->cluster_size - 1) >> sbi->cluster_bits;
 }
 
 static inline int __fat_get_block(struct inode *inode, sector_t iblock,
@@ -82,9 +119,10 @@ static inline int __fat_get_block(struct inode *inode, sector_t iblock,
 	}
 
 	offset = (unsigned long)iblock & (sbi->sec_per_clus - 1);
-	if (!offset) {
-		/* TODO: multiple cluster allocation would be desirable. */
-		err = fat_add_cluster(inode);
+	if (!offset && ((loff_t)iblock << sb->s_blocksize_bits) >=
+			((loff_t)inode->i_blocks << 9)) {
+		/* Not yet allocated by an earlier multi-cluster allocation */
+		err = fat_add_cluster(inode, fat_alloc_count(inode));
 		if (err)
 			return err;
 	}
@@ -533,6 +571,8 @@ static void init_once(void *foo)
 	ei->nr_caches = 0;
 	ei->cache_valid_id = FAT_CACHE_VALID + 1;
 	INIT_LIST_HEAD(&ei->cache_lru);
+	ei->cache_tree = RB_ROOT;
+	ei->alloc_end = 0;
 	INIT_HLIST_NODE(&ei->i_fat_hash);
 	inode_init_once(&ei->vfs_inode);
 }
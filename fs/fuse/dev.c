@@ -34,34 +34,55 @@ static struct fuse_conn *fuse_get_conn(struct file *file)
 	return file->private_data;
 }
 
-static void fuse_request_init(struct fuse_req *req)
+static void fuse_request_init(struct fuse_req *req, struct page **pages,
+			      unsigned npages)
 {
 	memset(req, 0, sizeof(*req));
 	INIT_LIST_HEAD(&req->list);
 	INIT_LIST_HEAD(&req->intr_entry);
 	init_waitqueue_head(&req->waitq);
 	atomic_set(&req->count, 1);
+	req->pages = pages;
+	req->max_pages = npages;
 }
 
-struct fuse_req *fuse_request_alloc(void)
+static struct fuse_req *__fuse_request_alloc(unsigned npages, gfp_t flags)
 {
-	struct fuse_req *req = kmem_cache_alloc(fuse_req_cachep, GFP_KERNEL);
-	if (req)
-		fuse_request_init(req);
+	struct fuse_req *req = kmem_cache_alloc(fuse_req_cachep, flags);
+	struct page **pages;
+
+	if (!req)
+		return NULL;
+
+	if (npages <= FUSE_REQ_INLINE_PAGES) {
+		pages = req->inline_pages;
+		npages = FUSE_REQ_INLINE_PAGES;
+	} else {
+		pages = kmalloc(sizeof(struct page *) * npages, flags);
+		if (!pages) {
+			kmem_cache_free(fuse_req_cachep, req);
+			return NULL;
+		}
+	}
+	fuse_request_init(req, pages, npages);
 	return req;
 }
+
+struct fuse_req *fuse_request_alloc(void)
+{
+	return __fuse_request_alloc(FUSE_REQ_INLINE_PAGES, GFP_KERNEL);
+}
 EXPORT_SYMBOL_GPL(fuse_request_alloc);
 
 struct fuse_req *fuse_request_alloc_nofs(void)
 {
-	struct fuse_req *req = kmem_cache_alloc(fuse_req_cachep, GFP_NOFS);
-	if (req)
-		fuse_request_init(req);
-	return req;
+	return __fuse_request_alloc(FUSE_REQ_INLINE_PAGES, GFP_NOFS);
 }
 
 void fuse_request_free(struct fuse_req *req)
 {
+	if (req->pages != req->inline_pages)
+		kfree(req->pages);
 	kmem_cache_free(fuse_req_cachep, req);
 }
 
@@ -97,7 +118,7 @@ static void fuse_req_init_context(struct fuse_req *req)
 	req->in.h.pid = current->pid;
 }
 
-struct fuse_req *fuse_get_req(struct fuse_conn *fc)
+struct fuse_req *fuse_get_req_pages(struct fuse_conn *fc, unsigned npages)
 {
 	struct fuse_req *req;
 	sigset_t oldset;
@@ -116,7 +137,7 @@ struct fuse_req *fuse_get_req(struct fuse_conn *fc)
 	if (!fc->connected)
 		goto out;
 
-	req = fuse_request_alloc();
+	req = __fuse_request_alloc(npages, GFP_KERNEL);
 	err = -ENOMEM;
 	if (!req)
 		goto out;
@@ -129,6 +150,11 @@ struct fuse_req *fuse_get_req(struct fuse_conn *fc)
 	atomic_dec(&fc->num_waiting);
 	return ERR_PTR(err);
 }
+
+struct fuse_req *fuse_get_req(struct fuse_conn *fc)
+{
+	return fuse_get_req_pages(fc, FUSE_REQ_INLINE_PAGES);
+}
 EXPORT_SYMBOL_GPL(fuse_get_req);
 
 /*
@@ -166,7 +192,7 @@ static void put_reserved_req(struct fuse_conn *fc, struct fuse_req *req)
 	struct fuse_file *ff = file->private_data;
 
 	spin_lock(&fc->lock);
-	fuse_request_init(req);
+	fuse_request_init(req, req->pages, req->max_pages);
 	BUG_ON(ff->reserved_req);
 	ff->reserved_req = req;
 	wake_up_all(&fc->reserved_req_waitq);
@@ -952,9 +978,13 @@ __releases(&fc->lock)
  * was an error during the copying then it's finished by calling
  * request_end().  Otherwise add it to the processing list, and set
  * the 'sent' flag.
+ *
+ * With 'more' set a request is already in the buffer: don't wait, and
+ * return 0 if nothing is queued or the next request doesn't fit.
  */
 static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
-				struct fuse_copy_state *cs, size_t nbytes)
+				struct fuse_copy_state *cs, size_t nbytes,
+				int more)
 {
 	int err;
 	struct fuse_req *req;
@@ -963,6 +993,9 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 
  restart:
 	spin_lock(&fc->lock);
+	err = 0;
+	if (more && (!fc->connected || !request_pending(fc)))
+		goto err_unlock;
 	err = -EAGAIN;
 	if ((file->f_flags & O_NONBLOCK) && fc->connected &&
 	    !request_pending(fc))
@@ -977,17 +1010,24 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 		goto err_unlock;
 
 	if (!list_empty(&fc->interrupts)) {
+		err = 0;
+		if (more && nbytes < sizeof(struct fuse_in_header) +
+				     sizeof(struct fuse_interrupt_in))
+			goto err_unlock;
 		req = list_entry(fc->interrupts.next, struct fuse_req,
 				 intr_entry);
 		return fuse_read_interrupt(fc, cs, nbytes, req);
 	}
 
 	req = list_entry(fc->pending.next, struct fuse_req, list);
-	req->state = FUSE_REQ_READING;
-	list_move(&req->list, &fc->io);
-
 	in = &req->in;
 	reqsize = in->h.len;
+	err = 0;
+	if (more && nbytes < reqsize)
+		goto err_unlock;
+
+	req->state = FUSE_REQ_READING;
+	list_move(&req->list, &fc->io);
 	/* If request is too large, reply with an error and restart the read */
 	if (nbytes < reqsize) {
 		req->out.h.error = -EIO;
@@ -1031,18 +1071,67 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	return err;
 }
 
+/*
+ * fuse_copy_finish() drops the rest of the last user page; give it back
+ * so that the next request is copied right after this one.
+ */
+static void fuse_copy_rewind(struct fuse_copy_state *cs)
+{
+	cs->addr -= cs->len;
+	cs->seglen += cs->len;
+	cs->len = 0;
+}
+
 static ssize_t fuse_dev_read(struct kiocb *iocb, const struct iovec *iov,
 			      unsigned long nr_segs, loff_t pos)
 {
 	struct fuse_copy_state cs;
 	struct file *file = iocb->ki_filp;
 	struct fuse_conn *fc = fuse_get_conn(file);
+	size_t nbytes = iov_length(iov, nr_segs);
+	ssize_t ret, total;
+
 	if (!fc)
 		return -EPERM;
 
 	fuse_copy_init(&cs, fc, 1, iov, nr_segs);
 
-	return fuse_dev_do_read(fc, file, &cs, iov_length(iov, nr_segs));
+	ret = fuse_dev_do_read(fc, file, &cs, nbytes, 0);
+	if (ret <= 0 || !fc->batch_read)
+		return ret;
+
+	/* Fill the rest of the buffer with whatever else is queued */
+	total = ret;
+	while (total < nbytes) {
+		fuse_copy_rewind(&cs);
+		ret = fuse_dev_do_read(fc, file, &cs, nbytes - total, 1);
+		if (ret <= 0)
+			break;
+		total += ret;
+	}
+	return total;
+}
+
+static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	struct fuse_conn *fc = fuse_get_conn(file);
+	u32 val;
+
+	if (!fc)
+		return -EPERM;
+
+	switch (cmd) {
+	case FUSE_DEV_IOC_BATCH_READ:
+		if (get_user(val, (u32 __user *) arg))
+			return -EFAULT;
+		spin_lock(&fc->lock);
+		fc->batch_read = val ? 1 : 0;
+		spin_unlock(&fc->lock);
+		return 0;
+	default:
+		return -ENOTTY;
+	}
 }
 
 static int fuse_dev_pipe_buf_steal(struct pipe_inode_info *pipe,
@@ -1081,7 +1170,7 @@ static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
 	fuse_copy_init(&cs, fc, 1, NULL, 0);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
-	ret = fuse_dev_do_read(fc, in, &cs, len);
+	ret = fuse_dev_do_read(fc, in, &cs, len, 0);
 	if (ret < 0)
 		goto out;
 
@@ -1634,6 +1723,8 @@ const struct file_operations fuse_dev_operations = {
 	.poll		= fuse_dev_poll,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
+	.unlocked_ioctl	= fuse_dev_ioctl,
+	.compat_ioctl	= fuse_dev_ioctl,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
@@ -584,10 +584,33 @@ static void fuse_send_readpages(struct fuse_req *req, struct file *file)
 	}
 }
 
+/*
+ * Size of the page vector for a request: only the pages a read or write
+ * can actually use are allocated, so small requests stay inline.
+ */
+static unsigned fuse_read_pages(struct fuse_conn *fc, unsigned nr_pages)
+{
+	unsigned max = min_t(unsigned, fc->max_read >> PAGE_CACHE_SHIFT,
+			     FUSE_MAX_PAGES_PER_REQ);
+
+	return min(nr_pages, max);
+}
+
+static unsigned fuse_span_pages(loff_t pos, size_t len)
+{
+	if (!len)
+		return 1;
+
+	return min_t(unsigned, ((pos + len - 1) >> PAGE_CACHE_SHIFT) -
+			       (pos >> PAGE_CACHE_SHIFT) + 1,
+		     FUSE_MAX_PAGES_PER_REQ);
+}
+
 struct fuse_fill_data {
 	struct fuse_req *req;
 	struct file *file;
 	struct inode *inode;
+	unsigned nr_pages;
 };
 
 static int fuse_readpages_fill(void *_data, struct page *page)
@@ -600,11 +623,12 @@ static int fuse_readpages_fill(void *_data, struct page *page)
 	fuse_wait_on_page_writeback(inode, page->index);
 
 	if (req->num_pages &&
-	    (req->num_pages == FUSE_MAX_PAGES_PER_REQ ||
+	    (req->num_pages == req->max_pages ||
 	     (req->num_pages + 1) * PAGE_CACHE_SIZE > fc->max_read ||
 	     req->pages[req->num_pages - 1]->index + 1 != page->index)) {
 		fuse_send_readpages(req, data->file);
-		data->req = req = fuse_get_req(fc);
+		data->req = req = fuse_get_req_pages(fc,
+				fuse_read_pages(fc, data->nr_pages));
 		if (IS_ERR(req)) {
 			unlock_page(page);
 			return PTR_ERR(req);
@@ -613,6 +637,7 @@ static int fuse_readpages_fill(void *_data, struct page *page)
 	page_cache_get(page);
 	req->pages[req->num_pages] = page;
 	req->num_pages++;
+	data->nr_pages--;
 	return 0;
 }
 
@@ -630,7 +655,8 @@ static int fuse_readpages(struct file *file, struct address_space *mapping,
 
 	data.file = file;
 	data.inode = inode;
-	data.req = fuse_get_req(fc);
+	data.nr_pages = nr_pages;
+	data.req = fuse_get_req_pages(fc, fuse_read_pages(fc, nr_pages));
 	err = PTR_ERR(data.req);
 	if (IS_ERR(data.req))
 		goto out;
@@ -879,7 +905,7 @@ static ssize_t fuse_fill_write_pages(struct fuse_req *req,
 		if (!fc->big_writes)
 			break;
 	} while (iov_iter_count(ii) && count < fc->max_write &&
-		 req->num_pages < FUSE_MAX_PAGES_PER_REQ && offset == 0);
+		 req->num_pages < req->max_pages && offset == 0);
 
 	return count > 0 ? count : err;
 }
@@ -900,7 +926,8 @@ static ssize_t fuse_perform_write(struct file *file,
 		struct fuse_req *req;
 		ssize_t count;
 
-		req = fuse_get_req(fc);
+		req = fuse_get_req_pages(fc, !fc->big_writes ? 1 :
+				fuse_span_pages(pos, iov_iter_count(ii)));
 		if (IS_ERR(req)) {
 			err = PTR_ERR(req);
 			break;
@@ -1013,9 +1040,9 @@ static int fuse_get_user_pages(struct fuse_req *req, const char __user *buf,
 		return 0;
 	}
 
-	nbytes = min_t(size_t, nbytes, FUSE_MAX_PAGES_PER_REQ << PAGE_SHIFT);
+	nbytes = min_t(size_t, nbytes, req->max_pages << PAGE_SHIFT);
 	npages = (nbytes + offset + PAGE_SIZE - 1) >> PAGE_SHIFT;
-	npages = clamp(npages, 1, FUSE_MAX_PAGES_PER_REQ);
+	npages = clamp(npages, 1, (int) req->max_pages);
 	npages = get_user_pages_fast(user_addr, npages, !write, req->pages);
 	if (npages < 0)
 		return npages;
@@ -1044,7 +1071,8 @@ ssize_t fuse_direct_io(struct file *file, const char __user *buf,
 	ssize_t res = 0;
 	struct fuse_req *req;
 
-	req = fuse_get_req(fc);
+	req = fuse_get_req_pages(fc, fuse_span_pages((unsigned long) buf,
+						     min(count, nmax)));
 	if (IS_ERR(req))
 		return PTR_ERR(req);
 
@@ -1080,7 +1108,9 @@ ssize_t fuse_direct_io(struct file *file, const char __user *buf,
 			break;
 		if (count) {
 			fuse_put_request(fc, req);
-			req = fuse_get_req(fc);
+			req = fuse_get_req_pages(fc,
+				fuse_span_pages((unsigned long) buf,
+						min(count, nmax)));
 			if (IS_ERR(req))
 				break;
 		}
@@ -1798,7 +1828,7 @@ long fuse_do_ioctl(struct file *file, unsigned int cmd, unsigned long arg,
 		num_pages++;
 	}
 
-	req = fuse_get_req(fc);
+	req = fuse_get_req_pages(fc, num_pages);
 	if (IS_ERR(req)) {
 		err = PTR_ERR(req);
 		req = NULL;
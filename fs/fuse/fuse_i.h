@@ -23,7 +23,11 @@
 #include <linux/poll.h>
 
 /** Max number of pages that can be used in a single read request */
-#define FUSE_MAX_PAGES_PER_REQ 32
+#define FUSE_MAX_PAGES_PER_REQ 128
+
+/** Number of page pointers embedded in a request, larger vectors are
+    allocated separately */
+#define FUSE_REQ_INLINE_PAGES 32
 
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
@@ -276,7 +280,13 @@ struct fuse_req {
 	} misc;
 
 	/** page vector */
-	struct page *pages[FUSE_MAX_PAGES_PER_REQ];
+	struct page **pages;
+
+	/** size of the page vector */
+	unsigned max_pages;
+
+	/** inline page vector, used unless more pages were asked for */
+	struct page *inline_pages[FUSE_REQ_INLINE_PAGES];
 
 	/** number of pages in vector */
 	unsigned num_pages;
@@ -456,6 +466,9 @@ struct fuse_conn {
 	/** Don't apply umask to creation modes */
 	unsigned dont_mask:1;
 
+	/** Return several requests per read of the device */
+	unsigned batch_read:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -638,6 +651,11 @@ void fuse_request_free(struct fuse_req *req);
  */
 struct fuse_req *fuse_get_req(struct fuse_conn *fc);
 
+/**
+ * Get a request with room for at least @npages pages, may fail with -ENOMEM
+ */
+struct fuse_req *fuse_get_req_pages(struct fuse_conn *fc, unsigned npages);
+
 /**
  * Gets a requests for a file operation, always succeeds
  */
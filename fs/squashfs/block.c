@@ -151,6 +151,14 @@ int squashfs_read_data(struct super_block *sb, void **buffer, u64 index,
 	}
 
 	if (compressed) {
+		/*
+		 * Wait for the I/O here rather than in the decompressor, so
+		 * the decompressor stream isn't held while sleeping on I/O.
+		 */
+		for (k = 0; k < b; k++)
+			wait_on_buffer(bh[k]);
+		k = 0;
+
 		length = squashfs_decompress(msblk, buffer, bh, b, offset,
 			 length, srclength, pages);
 		if (length < 0)
@@ -24,6 +24,8 @@
 #include <linux/types.h>
 #include <linux/mutex.h>
 #include <linux/buffer_head.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -40,9 +42,17 @@ static const struct squashfs_decompressor squashfs_lzma_unsupported_comp_ops = {
 	NULL, NULL, NULL, LZMA_COMPRESSION, "lzma", 0
 };
 
-static const struct squashfs_decompressor squashfs_lzo_unsupported_comp_ops = {
+#ifndef CONFIG_SQUASHFS_LZO
+static const struct squashfs_decompressor squashfs_lzo_comp_ops = {
 	NULL, NULL, NULL, LZO_COMPRESSION, "lzo", 0
 };
+#endif
+
+#ifndef CONFIG_SQUASHFS_XZ
+static const struct squashfs_decompressor squashfs_xz_comp_ops = {
+	NULL, NULL, NULL, XZ_COMPRESSION, "xz", 0
+};
+#endif
 
 static const struct squashfs_decompressor squashfs_unknown_comp_ops = {
 	NULL, NULL, NULL, 0, "unknown", 0
@@ -51,7 +61,8 @@ static const struct squashfs_decompressor squashfs_unknown_comp_ops = {
 static const struct squashfs_decompressor *decompressor[] = {
 	&squashfs_zlib_comp_ops,
 	&squashfs_lzma_unsupported_comp_ops,
-	&squashfs_lzo_unsupported_comp_ops,
+	&squashfs_lzo_comp_ops,
+	&squashfs_xz_comp_ops,
 	&squashfs_unknown_comp_ops
 };
 
@@ -66,3 +77,106 @@ const struct squashfs_decompressor *squashfs_lookup_decompressor(int id)
 
 	return decompressor[i];
 }
+
+
+void *squashfs_decompressor_create(struct super_block *sb,
+	unsigned short flags)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	struct squashfs_stream __percpu *percpu = NULL;
+	struct squashfs_stream *stream;
+	void *buffer = NULL;
+	int length = 0, cpu;
+
+	/*
+	 * Read compression options (if present) stored immediately after the
+	 * superblock.  The options block is always stored uncompressed, no
+	 * decompressor stream exists yet to read it
+	 */
+	if (SQUASHFS_COMP_OPTS(flags)) {
+		buffer = kmalloc(PAGE_CACHE_SIZE, GFP_KERNEL);
+		if (buffer == NULL)
+			return NULL;
+
+		length = squashfs_read_data(sb, &buffer,
+			sizeof(struct squashfs_super_block), 0, NULL,
+			PAGE_CACHE_SIZE, 1);
+
+		if (length < 0) {
+			ERROR("unable to read compression options\n");
+			goto out;
+		}
+	}
+
+	percpu = alloc_percpu(struct squashfs_stream);
+	if (percpu == NULL)
+		goto out;
+
+	for_each_possible_cpu(cpu) {
+		stream = per_cpu_ptr(percpu, cpu);
+		mutex_init(&stream->mutex);
+		stream->stream = msblk->decompressor->init(msblk, buffer,
+			length);
+		if (stream->stream == NULL)
+			goto failed;
+	}
+
+	goto out;
+
+failed:
+	for_each_possible_cpu(cpu) {
+		stream = per_cpu_ptr(percpu, cpu);
+		if (stream->stream)
+			msblk->decompressor->free(stream->stream);
+	}
+	free_percpu(percpu);
+	percpu = NULL;
+out:
+	kfree(buffer);
+	return (__force void *) percpu;
+}
+
+
+void squashfs_decompressor_destroy(struct squashfs_sb_info *msblk)
+{
+	struct squashfs_stream __percpu *percpu =
+			(struct squashfs_stream __percpu *) msblk->stream;
+	int cpu;
+
+	if (percpu == NULL)
+		return;
+
+	for_each_possible_cpu(cpu)
+		msblk->decompressor->free(per_cpu_ptr(percpu, cpu)->stream);
+	free_percpu(percpu);
+}
+
+
+/*
+ * Decompress using the stream of the CPU we're running on.  The stream
+ * mutex is only contended if we're preempted and another reader is
+ * scheduled on this CPU, or if we migrate to another CPU.  The caller has
+ * already waited for the buffer_heads, so the mutex isn't held over I/O.
+ */
+int squashfs_decompress(struct squashfs_sb_info *msblk, void **buffer,
+	struct buffer_head **bh, int b, int offset, int length, int srclength,
+	int pages)
+{
+	struct squashfs_stream __percpu *percpu =
+			(struct squashfs_stream __percpu *) msblk->stream;
+	struct squashfs_stream *stream;
+	int res;
+
+	if (percpu == NULL)
+		return -EIO;
+
+	stream = per_cpu_ptr(percpu, get_cpu());
+	put_cpu();
+
+	mutex_lock(&stream->mutex);
+	res = msblk->decompressor->decompress(msblk, stream->stream, buffer,
+		bh, b, offset, length, srclength, pages);
+	mutex_unlock(&stream->mutex);
+
+	return res;
+}
@@ -371,6 +371,110 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 }
 
 
+/*
+ * Decompress a datablock straight into the page cache pages it covers,
+ * rather than into the read_page cache and copying it from there.  This
+ * only works if every page covered by the block can be grabbed and none is
+ * already uptodate; otherwise -EAGAIN is returned and the caller uses the
+ * cache.  On success the pages, including target_page, are uptodate and
+ * unlocked.  On any other error target_page is left locked.
+ */
+static int squashfs_readpage_block(struct page *target_page, u64 block,
+	int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = start_index | mask;
+	int i, n, pages, bytes, res = -ENOMEM;
+	struct page **page;
+	void **pageaddr;
+
+	if (end_index > file_end)
+		end_index = file_end;
+	pages = end_index - start_index + 1;
+
+	page = kcalloc(pages, sizeof(*page), GFP_KERNEL);
+	pageaddr = kcalloc(pages, sizeof(*pageaddr), GFP_KERNEL);
+	if (page == NULL || pageaddr == NULL)
+		goto out;
+
+	res = -EAGAIN;
+	for (i = 0, n = start_index; n <= end_index; i++, n++) {
+		page[i] = (n == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+
+		if (page[i] == NULL)
+			goto release_pages;
+
+		if (PageUptodate(page[i])) {
+			if (page[i] != target_page) {
+				unlock_page(page[i]);
+				page_cache_release(page[i]);
+			}
+			page[i] = NULL;
+			goto release_pages;
+		}
+	}
+
+	for (i = 0; i < pages; i++)
+		pageaddr[i] = kmap(page[i]);
+
+	/*
+	 * A datablock never decompresses to more than the pages it covers,
+	 * and a compressed block is always smaller than its uncompressed
+	 * size, so bound the source length by the pages as well.
+	 */
+	bytes = squashfs_read_data(inode->i_sb, pageaddr, block, bsize, NULL,
+		pages << PAGE_CACHE_SHIFT, pages);
+
+	if (bytes >= 0 && (bytes & (PAGE_CACHE_SIZE - 1)))
+		memset(pageaddr[bytes >> PAGE_CACHE_SHIFT] +
+			(bytes & (PAGE_CACHE_SIZE - 1)), 0,
+			PAGE_CACHE_SIZE - (bytes & (PAGE_CACHE_SIZE - 1)));
+
+	for (i = 0; i < pages; i++) {
+		if (bytes >= 0 && (i << PAGE_CACHE_SHIFT) >= bytes)
+			memset(pageaddr[i], 0, PAGE_CACHE_SIZE);
+		kunmap(page[i]);
+	}
+
+	if (bytes < 0) {
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+		res = -EIO;
+		goto release_pages;
+	}
+
+	for (i = 0; i < pages; i++) {
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		if (page[i] != target_page)
+			page_cache_release(page[i]);
+	}
+
+	kfree(pageaddr);
+	kfree(page);
+	return 0;
+
+release_pages:
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL || page[i] == target_page)
+			continue;
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+
+out:
+	kfree(pageaddr);
+	kfree(page);
+	return res;
+}
+
+
 static int squashfs_readpage(struct file *file, struct page *page)
 {
 	struct inode *inode = page->mapping->host;
@@ -410,8 +514,16 @@ static int squashfs_readpage(struct file *file, struct page *page)
 			sparse = 1;
 		} else {
 			/*
-			 * Read and decompress datablock.
+			 * Try decompressing straight into the page cache,
+			 * otherwise read and decompress datablock into the
+			 * cache.
 			 */
+			int res = squashfs_readpage_block(page, block, bsize);
+			if (res == 0)
+				return 0;
+			if (res != -EAGAIN && res != -ENOMEM)
+				goto error_out;
+
 			buffer = squashfs_get_datablock(inode->i_sb,
 								block, bsize);
 			if (buffer->error) {
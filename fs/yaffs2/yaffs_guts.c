@@ -1238,6 +1238,7 @@ static yaffs_Object *yaffs_AllocateEmptyObject(yaffs_Device *dev)
 		YINIT_LIST_HEAD(&(obj->hardLinks));
 		YINIT_LIST_HEAD(&(obj->hashLink));
 		YINIT_LIST_HEAD(&obj->siblings);
+		YINIT_LIST_HEAD(&obj->cacheChunks);
 
 
 		/* Now make the directory sane */
@@ -1319,6 +1320,9 @@ static void yaffs_FreeObject(yaffs_Object *obj)
 	}
 
 	yaffs_UnhashObject(obj);
+	yaffs_InvalidateWholeChunkCache(obj);
+	if (dev->raObject == obj)
+		dev->raObject = NULL;
 
 	yaffs_FreeRawObject(dev,obj);
 	dev->nObjects--;
@@ -2384,10 +2388,18 @@ static unsigned yaffs_FindBlockForGarbageCollection(yaffs_Device *dev,
 	int prioritisedExists = 0;
 	yaffs_BlockInfo *bi;
 	int threshold;
+	int costBenefit;
+	unsigned score;
+
+	/* Background gc on yaffs2 ranks blocks by cost-benefit rather than
+	 * just picking the dirtiest.
+	 */
+	costBenefit = background && !aggressive && dev->param.isYaffs2;
 
 	/* First let's see if we need to grab a prioritised block */
 	if (dev->hasPendingPrioritisedGCs && !aggressive) {
 		dev->gcDirtiest = 0;
+		dev->gcDirtiestScore = 0;
 		bi = dev->blockInfo;
 		for (i = dev->internalStartBlock;
 			i <= dev->internalEndBlock && !selected;
@@ -2468,11 +2480,29 @@ static unsigned yaffs_FindBlockForGarbageCollection(yaffs_Device *dev,
 
 			pagesUsed = bi->pagesInUse - bi->softDeletions;
 
-			if (bi->blockState == YAFFS_BLOCK_STATE_FULL &&
-				pagesUsed < dev->param.nChunksPerBlock &&
-				(dev->gcDirtiest < 1 || pagesUsed < dev->gcPagesInUse) &&
+			if (bi->blockState != YAFFS_BLOCK_STATE_FULL ||
+				pagesUsed >= dev->param.nChunksPerBlock)
+				continue;
+
+			if (costBenefit) {
+				/*
+				 * Only blocks that pass the threshold compete,
+				 * otherwise an old, nearly full block can win
+				 * every scan and never be selected.
+				 */
+				if (pagesUsed > threshold)
+					continue;
+				score = yaffs2_GCBlockScore(dev, bi);
+				if ((dev->gcDirtiest < 1 || score > dev->gcDirtiestScore) &&
+					yaffs2_BlockNotDisqualifiedFromGC(dev, bi)) {
+					dev->gcDirtiest = dev->gcBlockFinder;
+					dev->gcDirtiestScore = score;
+					dev->gcPagesInUse = pagesUsed;
+				}
+			} else if ((dev->gcDirtiest < 1 || pagesUsed < dev->gcPagesInUse) &&
 				yaffs2_BlockNotDisqualifiedFromGC(dev, bi)) {
 				dev->gcDirtiest = dev->gcBlockFinder;
+				dev->gcDirtiestScore = 0;
 				dev->gcPagesInUse = pagesUsed;
 			}
 		}
@@ -2511,6 +2541,7 @@ static unsigned yaffs_FindBlockForGarbageCollection(yaffs_Device *dev,
 			dev->backgroundGCs++;
 
 		dev->gcDirtiest = 0;
+		dev->gcDirtiestScore = 0;
 		dev->gcPagesInUse = 0;
 		dev->gcNotDone = 0;
 		if(dev->refreshSkip > 0)
@@ -2529,6 +2560,35 @@ static unsigned yaffs_FindBlockForGarbageCollection(yaffs_Device *dev,
 	return selected;
 }
 
+/*
+ * yaffs_DeferGarbageCollection()
+ * Lets the OS background gc thread do passive collection instead of the
+ * writer. The thread is kicked early once the erased blocks drop into the
+ * background reserve. Returns non-zero if the background thread has it.
+ */
+static int yaffs_DeferGarbageCollection(yaffs_Device *dev, int minErased)
+{
+	int urgent;
+
+	if (!dev->param.gcWake)
+		return 0;
+
+	urgent = dev->nErasedBlocks < minErased + dev->param.nBgReserveBlocks;
+
+	return dev->param.gcWake(dev, urgent);
+}
+
+/*
+ * yaffs_MinErasedBlocks()
+ * Erased blocks below which writers collect aggressively themselves.
+ * The background thread uses the same figure for its urgency.
+ */
+int yaffs_MinErasedBlocks(yaffs_Device *dev)
+{
+	return dev->param.nReservedBlocks +
+		yaffs2_CalcCheckpointBlocksRequired(dev) + 1;
+}
+
 /* New garbage collector
  * If we're very low on erased blocks then we do aggressive garbage collection
  * otherwise we do "leasurely" garbage collection.
@@ -2545,7 +2605,6 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev, int background)
 	int maxTries = 0;
 	int minErased;
 	int erasedChunks;
-	int checkpointBlockAdjust;
 
 	if(dev->param.gcControl &&
 		(dev->param.gcControl(dev) & 1) == 0)
@@ -2563,16 +2622,16 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev, int background)
 	do {
 		maxTries++;
 
-		checkpointBlockAdjust = yaffs2_CalcCheckpointBlocksRequired(dev);
-
-		minErased  = dev->param.nReservedBlocks + checkpointBlockAdjust + 1;
+		minErased = yaffs_MinErasedBlocks(dev);
 		erasedChunks = dev->nErasedBlocks * dev->param.nChunksPerBlock;
 
 		/* If we need a block soon then do aggressive gc.*/
 		if (dev->nErasedBlocks < minErased)
 			aggressive = 1;
 		else {
-			if(!background && erasedChunks > (dev->nFreeChunks / 4))
+			if(!background &&
+				(yaffs_DeferGarbageCollection(dev, minErased) ||
+				 erasedChunks > (dev->nFreeChunks / 4)))
 				break;
 
 			if(dev->gcSkip > 20)
@@ -3176,21 +3235,56 @@ int yaffs_UpdateObjectHeader(yaffs_Object *in, const YCHAR *name, int force,
  *   In Linux, the page cache provides read buffering aand the short op cache provides write
  *   buffering.
  *
- *   There are a limited number (~10) of cache chunks per device so that we don't
- *   need a very intelligent search.
+ *   Cache chunks in use are hashed by (object, chunkId) for lookup, kept on a
+ *   per-object list for flushing and invalidation, and on a device-wide LRU list
+ *   for eviction. Unused cache chunks sit on a free list, so none of the common
+ *   operations need to search the whole cache.
+ *
+ *   Partial chunk writes are held dirty in the cache until the object is flushed
+ *   or the chunk is pushed out, so small appends get coalesced into full chunks
+ *   before they are programmed.
  */
 
+static Y_INLINE int yaffs_HashChunkCache(const yaffs_Object *obj, int chunkId)
+{
+	return (obj->objectId * 31 + chunkId) & (YAFFS_NCACHE_BUCKETS - 1);
+}
+
+/* Bind a free cache chunk to an object's chunk */
+static void yaffs_AttachChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache,
+				yaffs_Object *obj, int chunkId)
+{
+	ylist_del_init(&cache->hashList);
+	cache->object = obj;
+	cache->chunkId = chunkId;
+	cache->dirty = 0;
+	cache->locked = 0;
+	cache->nBytes = 0;
+	ylist_add(&cache->hashList,
+		&dev->srCacheBuckets[yaffs_HashChunkCache(obj, chunkId)]);
+	ylist_add(&cache->objectList, &obj->cacheChunks);
+	ylist_add_tail(&cache->lruList, &dev->srCacheLru);
+}
+
+/* Unbind a cache chunk and put it back on the free list */
+static void yaffs_ReleaseChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache)
+{
+	ylist_del_init(&cache->hashList);
+	ylist_del_init(&cache->objectList);
+	ylist_del_init(&cache->lruList);
+	cache->object = NULL;
+	cache->dirty = 0;
+	ylist_add(&cache->hashList, &dev->srCacheFree);
+}
+
 static int yaffs_ObjectHasCachedWriteData(yaffs_Object *obj)
 {
-	yaffs_Device *dev = obj->myDev;
-	int i;
+	struct ylist_head *i;
 	yaffs_ChunkCache *cache;
-	int nCaches = obj->myDev->param.nShortOpCaches;
 
-	for (i = 0; i < nCaches; i++) {
-		cache = &dev->srCache[i];
-		if (cache->object == obj &&
-		    cache->dirty)
+	ylist_for_each(i, &obj->cacheChunks) {
+		cache = ylist_entry(i, yaffs_ChunkCache, objectList);
+		if (cache->dirty)
 			return 1;
 	}
 
@@ -3201,27 +3295,21 @@ static int yaffs_ObjectHasCachedWriteData(yaffs_Object *obj)
 static void yaffs_FlushFilesChunkCache(yaffs_Object *obj)
 {
 	yaffs_Device *dev = obj->myDev;
-	int lowest = -99;	/* Stop compiler whining. */
-	int i;
+	struct ylist_head *i;
 	yaffs_ChunkCache *cache;
+	yaffs_ChunkCache *c;
 	int chunkWritten = 0;
-	int nCaches = obj->myDev->param.nShortOpCaches;
 
-	if (nCaches > 0) {
+	if (dev->param.nShortOpCaches > 0) {
 		do {
 			cache = NULL;
 
 			/* Find the dirty cache for this object with the lowest chunk id. */
-			for (i = 0; i < nCaches; i++) {
-				if (dev->srCache[i].object == obj &&
-				    dev->srCache[i].dirty) {
-					if (!cache
-					    || dev->srCache[i].chunkId <
-					    lowest) {
-						cache = &dev->srCache[i];
-						lowest = cache->chunkId;
-					}
-				}
+			ylist_for_each(i, &obj->cacheChunks) {
+				c = ylist_entry(i, yaffs_ChunkCache, objectList);
+				if (c->dirty &&
+				    (!cache || c->chunkId < cache->chunkId))
+					cache = c;
 			}
 
 			if (cache && !cache->locked) {
@@ -3233,8 +3321,7 @@ static void yaffs_FlushFilesChunkCache(yaffs_Object *obj)
 								 cache->data,
 								 cache->nBytes,
 								 1);
-				cache->dirty = 0;
-				cache->object = NULL;
+				yaffs_ReleaseChunkCache(dev, cache);
 			}
 
 		} while (cache && chunkWritten > 0);
@@ -3286,14 +3373,9 @@ void yaffs_FlushEntireDeviceCache(yaffs_Device *dev)
  */
 static yaffs_ChunkCache *yaffs_GrabChunkCacheWorker(yaffs_Device *dev)
 {
-	int i;
-
-	if (dev->param.nShortOpCaches > 0) {
-		for (i = 0; i < dev->param.nShortOpCaches; i++) {
-			if (!dev->srCache[i].object)
-				return &dev->srCache[i];
-		}
-	}
+	if (dev->param.nShortOpCaches > 0 && !ylist_empty(&dev->srCacheFree))
+		return ylist_entry(dev->srCacheFree.next,
+				yaffs_ChunkCache, hashList);
 
 	return NULL;
 }
@@ -3301,10 +3383,8 @@ static yaffs_ChunkCache *yaffs_GrabChunkCacheWorker(yaffs_Device *dev)
 static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device *dev)
 {
 	yaffs_ChunkCache *cache;
-	yaffs_Object *theObj;
-	int usage;
-	int i;
-	int pushout;
+	yaffs_ChunkCache *c;
+	struct ylist_head *i;
 
 	if (dev->param.nShortOpCaches > 0) {
 		/* Try find a non-dirty one... */
@@ -3312,36 +3392,27 @@ static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device *dev)
 		cache = yaffs_GrabChunkCacheWorker(dev);
 
 		if (!cache) {
-			/* They were all dirty, find the last recently used object and flush
-			 * its cache, then  find again.
+			/* None free, take the least recently used unlocked one.
+			 * If it is dirty then flush its object and find again.
 			 * NB what's here is not very accurate, we actually flush the object
 			 * the last recently used page.
 			 */
 
-			/* With locking we can't assume we can use entry zero */
-
-			theObj = NULL;
-			usage = -1;
-			cache = NULL;
-			pushout = -1;
-
-			for (i = 0; i < dev->param.nShortOpCaches; i++) {
-				if (dev->srCache[i].object &&
-				    !dev->srCache[i].locked &&
-				    (dev->srCache[i].lastUse < usage || !cache)) {
-					usage = dev->srCache[i].lastUse;
-					theObj = dev->srCache[i].object;
-					cache = &dev->srCache[i];
-					pushout = i;
+			ylist_for_each(i, &dev->srCacheLru) {
+				c = ylist_entry(i, yaffs_ChunkCache, lruList);
+				if (!c->locked) {
+					cache = c;
+					break;
 				}
 			}
 
-			if (!cache || cache->dirty) {
+			if (cache && !cache->dirty) {
+				yaffs_ReleaseChunkCache(dev, cache);
+			} else if (cache) {
 				/* Flush and try again */
-				yaffs_FlushFilesChunkCache(theObj);
-				cache = yaffs_GrabChunkCacheWorker(dev);
+				yaffs_FlushFilesChunkCache(cache->object);
 			}
-
+			cache = yaffs_GrabChunkCacheWorker(dev);
 		}
 		return cache;
 	} else
@@ -3349,43 +3420,44 @@ static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device *dev)
 
 }
 
-/* Find a cached chunk */
-static yaffs_ChunkCache *yaffs_FindChunkCache(const yaffs_Object *obj,
+static yaffs_ChunkCache *yaffs_LookupChunkCache(const yaffs_Object *obj,
 					      int chunkId)
 {
 	yaffs_Device *dev = obj->myDev;
-	int i;
-	if (dev->param.nShortOpCaches > 0) {
-		for (i = 0; i < dev->param.nShortOpCaches; i++) {
-			if (dev->srCache[i].object == obj &&
-			    dev->srCache[i].chunkId == chunkId) {
-				dev->cacheHits++;
+	struct ylist_head *i;
+	yaffs_ChunkCache *cache;
 
-				return &dev->srCache[i];
-			}
+	if (dev->param.nShortOpCaches > 0) {
+		ylist_for_each(i, &dev->srCacheBuckets[yaffs_HashChunkCache(obj, chunkId)]) {
+			cache = ylist_entry(i, yaffs_ChunkCache, hashList);
+			if (cache->object == obj &&
+			    cache->chunkId == chunkId)
+				return cache;
 		}
 	}
 	return NULL;
 }
 
+/* Find a cached chunk */
+static yaffs_ChunkCache *yaffs_FindChunkCache(const yaffs_Object *obj,
+					      int chunkId)
+{
+	yaffs_ChunkCache *cache = yaffs_LookupChunkCache(obj, chunkId);
+
+	if (cache)
+		obj->myDev->cacheHits++;
+
+	return cache;
+}
+
 /* Mark the chunk for the least recently used algorithym */
 static void yaffs_UseChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache,
 				int isAWrite)
 {
 
 	if (dev->param.nShortOpCaches > 0) {
-		if (dev->srLastUse < 0 || dev->srLastUse > 100000000) {
-			/* Reset the cache usages */
-			int i;
-			for (i = 1; i < dev->param.nShortOpCaches; i++)
-				dev->srCache[i].lastUse = 0;
-
-			dev->srLastUse = 0;
-		}
-
-		dev->srLastUse++;
-
-		cache->lastUse = dev->srLastUse;
+		ylist_del(&cache->lruList);
+		ylist_add_tail(&cache->lruList, &dev->srCacheLru);
 
 		if (isAWrite)
 			cache->dirty = 1;
@@ -3402,7 +3474,7 @@ static void yaffs_InvalidateChunkCache(yaffs_Object *object, int chunkId)
 		yaffs_ChunkCache *cache = yaffs_FindChunkCache(object, chunkId);
 
 		if (cache)
-			cache->object = NULL;
+			yaffs_ReleaseChunkCache(object->myDev, cache);
 	}
 }
 
@@ -3411,15 +3483,62 @@ static void yaffs_InvalidateChunkCache(yaffs_Object *object, int chunkId)
  */
 static void yaffs_InvalidateWholeChunkCache(yaffs_Object *in)
 {
-	int i;
 	yaffs_Device *dev = in->myDev;
+	yaffs_ChunkCache *cache;
 
-	if (dev->param.nShortOpCaches > 0) {
-		/* Invalidate it. */
-		for (i = 0; i < dev->param.nShortOpCaches; i++) {
-			if (dev->srCache[i].object == in)
-				dev->srCache[i].object = NULL;
-		}
+	while (!ylist_empty(&in->cacheChunks)) {
+		cache = ylist_entry(in->cacheChunks.next,
+				yaffs_ChunkCache, objectList);
+		yaffs_ReleaseChunkCache(dev, cache);
+	}
+}
+
+/* Sequential readahead into the cache.
+ * When partial-chunk reads of an object walk forward chunk by chunk, pull
+ * the next few chunks into free cache slots so later reads are served from
+ * RAM. Only free slots are used: live entries are never pushed out.
+ * Full-chunk reads bypass the cache and rely on the VFS readahead instead.
+ */
+static void yaffs_ReadAheadChunkCache(yaffs_Object *in, int chunk)
+{
+	yaffs_Device *dev = in->myDev;
+	yaffs_ChunkCache *cache;
+	int nChunks;
+	int lastChunk;
+	int ra;
+	int i;
+
+	ra = dev->param.nCacheReadAhead;
+	if (ra > dev->param.nShortOpCaches / 2)
+		ra = dev->param.nShortOpCaches / 2;
+
+	if (ra < 1 || in->variantType != YAFFS_OBJECT_TYPE_FILE)
+		return;
+
+	if (dev->raObject != in || dev->raNextChunk != chunk) {
+		dev->raObject = in;
+		dev->raNextChunk = chunk + 1;
+		return;
+	}
+	dev->raNextChunk = chunk + 1;
+
+	nChunks = (in->variant.fileVariant.fileSize + dev->nDataBytesPerChunk - 1) /
+			dev->nDataBytesPerChunk;
+	lastChunk = chunk + ra;
+	if (lastChunk > nChunks)
+		lastChunk = nChunks;
+
+	for (i = chunk + 1; i <= lastChunk; i++) {
+		if (yaffs_LookupChunkCache(in, i))
+			continue;
+
+		cache = yaffs_GrabChunkCacheWorker(dev);
+		if (!cache)
+			break;
+
+		yaffs_AttachChunkCache(dev, cache, in, i);
+		yaffs_ReadChunkDataFromObject(in, i, cache->data);
+		dev->cacheReadAheads++;
 	}
 }
 
@@ -3476,14 +3595,10 @@ int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 
 				if (!cache) {
 					cache = yaffs_GrabChunkCache(in->myDev);
-					cache->object = in;
-					cache->chunkId = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
+					yaffs_AttachChunkCache(dev, cache, in, chunk);
 					yaffs_ReadChunkDataFromObject(in, chunk,
 								      cache->
 								      data);
-					cache->nBytes = 0;
 				}
 
 				yaffs_UseChunkCache(dev, cache, 0);
@@ -3494,6 +3609,9 @@ int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 				memcpy(buffer, &cache->data[start], nToCopy);
 
 				cache->locked = 0;
+
+				if (nToCopy != dev->nDataBytesPerChunk)
+					yaffs_ReadAheadChunkCache(in, chunk);
 			} else {
 				/* Read into the local buffer then copy..*/
 
@@ -3603,10 +3721,7 @@ int yaffs_DoWriteDataToFile(yaffs_Object *in, const __u8 *buffer, loff_t offset,
 				if (!cache
 				    && yaffs_CheckSpaceForAllocation(dev, 1)) {
 					cache = yaffs_GrabChunkCache(dev);
-					cache->object = in;
-					cache->chunkId = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
+					yaffs_AttachChunkCache(dev, cache, in, chunk);
 					yaffs_ReadChunkDataFromObject(in, chunk,
 								      cache->data);
 				} else if (cache &&
@@ -5270,6 +5385,7 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 	dev->passiveGCs = 0;
 	dev->oldestDirtyGCs = 0;
 	dev->backgroundGCs = 0;
+	dev->backgroundGCWakes = 0;
 	dev->gcBlockFinder = 0;
 	dev->bufferedBlock = -1;
 	dev->doingBufferedBlockRewrite = 0;
@@ -5300,11 +5416,13 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 	    dev->param.nShortOpCaches > 0) {
 		int i;
 		void *buf;
-		int srCacheBytes = dev->param.nShortOpCaches * sizeof(yaffs_ChunkCache);
+		int srCacheBytes;
 
 		if (dev->param.nShortOpCaches > YAFFS_MAX_SHORT_OP_CACHES)
 			dev->param.nShortOpCaches = YAFFS_MAX_SHORT_OP_CACHES;
 
+		srCacheBytes = dev->param.nShortOpCaches * sizeof(yaffs_ChunkCache);
+
 		dev->srCache =  YMALLOC(srCacheBytes);
 
 		buf = (__u8 *) dev->srCache;
@@ -5312,18 +5430,28 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 		if (dev->srCache)
 			memset(dev->srCache, 0, srCacheBytes);
 
+		YINIT_LIST_HEAD(&dev->srCacheFree);
+		YINIT_LIST_HEAD(&dev->srCacheLru);
+		for (i = 0; i < YAFFS_NCACHE_BUCKETS; i++)
+			YINIT_LIST_HEAD(&dev->srCacheBuckets[i]);
+
 		for (i = 0; i < dev->param.nShortOpCaches && buf; i++) {
 			dev->srCache[i].object = NULL;
-			dev->srCache[i].lastUse = 0;
 			dev->srCache[i].dirty = 0;
+			YINIT_LIST_HEAD(&dev->srCache[i].hashList);
+			YINIT_LIST_HEAD(&dev->srCache[i].objectList);
+			YINIT_LIST_HEAD(&dev->srCache[i].lruList);
+			ylist_add_tail(&dev->srCache[i].hashList, &dev->srCacheFree);
 			dev->srCache[i].data = buf = YMALLOC_DMA(dev->param.totalBytesPerChunk);
 		}
 		if (!buf)
 			init_failed = 1;
-
-		dev->srLastUse = 0;
 	}
 
+	dev->raObject = NULL;
+	dev->raNextChunk = 0;
+	dev->cacheReadAheads = 0;
+
 	dev->cacheHits = 0;
 
 	if (!init_failed) {
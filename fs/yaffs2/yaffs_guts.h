@@ -88,7 +88,8 @@
 #define YAFFS_SEQUENCE_CHECKPOINT_DATA  0x21
 
 
-#define YAFFS_MAX_SHORT_OP_CACHES	20
+#define YAFFS_MAX_SHORT_OP_CACHES	256
+#define YAFFS_NCACHE_BUCKETS		64	/* Must be a power of 2 */
 
 #define YAFFS_N_TEMP_BUFFERS		6
 
@@ -111,11 +112,18 @@
 /* Special sequence number for bad block that failed to be marked bad */
 #define YAFFS_SEQUENCE_BAD_BLOCK	0xFFFF0000
 
+/* Cap on block age (in sequence numbers) used in gc cost-benefit scoring.
+ * Keeps the score from overflowing and stops very old blocks swamping it.
+ */
+#define YAFFS_GC_MAX_AGE		0x10000
+
 /* ChunkCache is used for short read/write operations.*/
 typedef struct {
+	struct ylist_head hashList;	/* Hash bucket entry, or free list if unused */
+	struct ylist_head objectList;	/* Entry in the owning object's cacheChunks */
+	struct ylist_head lruList;	/* Entry in the device LRU list */
 	struct yaffs_ObjectStruct *object;
 	int chunkId;
-	int lastUse;
 	int dirty;
 	int nBytes;		/* Only valid if the cache is dirty */
 	int locked;		/* Can't push out or flush while locked. */
@@ -435,6 +443,8 @@ struct yaffs_ObjectStruct {
 	struct yaffs_ObjectStruct *parent;
 	struct ylist_head siblings;
 
+	struct ylist_head cacheChunks;	/* short op cache chunks holding this object's data */
+
 	/* Where's my object header in NAND? */
 	int hdrChunk;
 
@@ -531,11 +541,17 @@ struct yaffs_DeviceParamStruct {
 	int endBlock;		/* End block we're allowed to use */
 	int nReservedBlocks;	/* We want this tuneable so that we can reduce */
 				/* reserved blocks on NOR and RAM. */
+	int nBgReserveBlocks;	/* Extra erased blocks the background gc tries */
+				/* to keep in hand so writes don't gc inline. */
 
 
 	int nShortOpCaches;	/* If <= 0, then short op caching is disabled, else
-				 * the number of short op caches (don't use too many).
-                                 * 10 to 20 is a good bet.
+				 * the number of short op caches.
+				 * Lookups are hashed so larger caches are fine.
+				 */
+	int nCacheReadAhead;	/* Chunks to read ahead into free cache
+				 * slots on sequential partial-chunk reads.
+				 * 0 disables readahead.
 				 */
 	int useNANDECC;		/* Flag to decide whether or not to use NANDECC on data (yaffs1) */
 	int noTagsECC;		/* Flag to decide whether or not to do ECC on packed tags (yaffs2) */ 
@@ -590,6 +606,11 @@ struct yaffs_DeviceParamStruct {
 	/*  Callback to control garbage collection. */
 	unsigned (*gcControl)(struct yaffs_DeviceStruct *dev);
 
+	/* Callback to hand passive gc to a background thread. Returns non-zero
+	 * if a background gc is running. If urgent is set it should be woken now.
+	 */
+	int (*gcWake)(struct yaffs_DeviceStruct *dev, int urgent);
+
         /* Debug control flags. Don't use unless you know what you're doing */
 	int useHeaderFileSize;	/* Flag to determine if we should use file sizes from the header */
 	int disableLazyLoad;	/* Disable lazy loading on this device */
@@ -700,6 +721,7 @@ struct yaffs_DeviceStruct {
 	unsigned gcDisable;
 	unsigned gcBlockFinder;
 	unsigned gcDirtiest;
+	unsigned gcDirtiestScore;	/* Cost-benefit score of gcDirtiest (background gc) */
 	unsigned gcPagesInUse;
 	unsigned gcNotDone;
 	unsigned gcBlock;
@@ -719,7 +741,13 @@ struct yaffs_DeviceStruct {
 	int doingBufferedBlockRewrite;
 
 	yaffs_ChunkCache *srCache;
-	int srLastUse;
+	struct ylist_head srCacheFree;	/* Unused cache chunks */
+	struct ylist_head srCacheLru;	/* In use cache chunks, least recently used first */
+	struct ylist_head srCacheBuckets[YAFFS_NCACHE_BUCKETS];
+
+	/* Sequential read detection for cache readahead */
+	yaffs_Object *raObject;
+	int raNextChunk;
 
 	/* Stuff for background deletion and unlinked files.*/
 	yaffs_Object *unlinkedDir;	/* Directory where unlinked and deleted files live. */
@@ -759,6 +787,7 @@ struct yaffs_DeviceStruct {
 	__u32 oldestDirtyGCs;
 	__u32 nGCBlocks;
 	__u32 backgroundGCs;
+	__u32 backgroundGCWakes;
 	__u32 nRetriedWrites;
 	__u32 nRetiredBlocks;
 	__u32 eccFixed;
@@ -769,6 +798,7 @@ struct yaffs_DeviceStruct {
 	__u32 nUnmarkedDeletions;
 	__u32 refreshCount;
 	__u32 cacheHits;
+	__u32 cacheReadAheads;
 
 };
 
@@ -915,6 +945,7 @@ void yaffs_HandleDeferedFree(yaffs_Object *obj);
 void yaffs_UpdateDirtyDirectories(yaffs_Device *dev);
 
 int yaffs_BackgroundGarbageCollect(yaffs_Device *dev, unsigned urgency);
+int yaffs_MinErasedBlocks(yaffs_Device *dev);
 
 /* Debug dump  */
 int yaffs_DumpObject(yaffs_Object *obj);
@@ -25,6 +25,7 @@ struct yaffs_LinuxContext {
 	struct super_block * superBlock;
 	struct task_struct *bgThread; /* Background thread for this device */
 	int bgRunning;
+	int bgKick;	/* Set by writers to get the bg gc going early */
         struct semaphore grossLock;     /* Gross locking semaphore */
 	__u8 *spareBuffer;      /* For mtdif2 use. Don't know the size of the buffer
 				 * at compile time so we have to allocate it.
@@ -176,6 +176,9 @@ unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
 unsigned int yaffs_auto_checkpoint = 1;
 unsigned int yaffs_gc_control = 1;
 unsigned int yaffs_bg_enable = 1;
+unsigned int yaffs_bg_reserve = 4;
+unsigned int yaffs_cache_chunks = 32;
+unsigned int yaffs_cache_readahead = 4;
 
 /* Module Parameters */
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
@@ -184,6 +187,9 @@ module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
 module_param(yaffs_gc_control, uint, 0644);
 module_param(yaffs_bg_enable, uint, 0644);
+module_param(yaffs_bg_reserve, uint, 0644);
+module_param(yaffs_cache_chunks, uint, 0644);
+module_param(yaffs_cache_readahead, uint, 0644);
 #else
 MODULE_PARM(yaffs_traceMask, "i");
 MODULE_PARM(yaffs_wr_attempts, "i");
@@ -512,6 +518,21 @@ static unsigned yaffs_gc_control_callback(yaffs_Device *dev)
 {
 	return yaffs_gc_control;
 }
+
+static int yaffs_gc_wake_callback(yaffs_Device *dev, int urgent)
+{
+	struct yaffs_LinuxContext *context = yaffs_DeviceToLC(dev);
+
+	if(!context->bgRunning || !context->bgThread || !yaffs_bg_enable)
+		return 0;
+
+	if(urgent && !context->bgKick){
+		context->bgKick = 1;
+		dev->backgroundGCWakes++;
+		wake_up_process(context->bgThread);
+	}
+	return 1;
+}
                 	                                                                                          	
 static void yaffs_GrossLock(yaffs_Device *dev)
 {
@@ -2265,6 +2286,9 @@ static unsigned yaffs_bg_gc_urgency(yaffs_Device *dev)
 		return 0;
 	else if(scatteredFree < (dev->param.nChunksPerBlock * 2))
 		return 0;
+	else if(dev->nErasedBlocks <
+		yaffs_MinErasedBlocks(dev) + dev->param.nBgReserveBlocks)
+		return 2;
 	else if(erasedChunks > dev->nFreeChunks/2)
 		return 0;
 	else if(erasedChunks > dev->nFreeChunks/4)
@@ -2364,7 +2388,9 @@ static int yaffs_BackgroundThread(void *data)
 			next_dir_update = now + HZ;
 		}
 
-		if(time_after(now,next_gc) && yaffs_bg_enable){
+		if((time_after(now,next_gc) || context->bgKick) &&
+			yaffs_bg_enable){
+			context->bgKick = 0;
 			if(!dev->isCheckpointed){
 				urgency = yaffs_bg_gc_urgency(dev);
 				gcResult = yaffs_BackgroundGarbageCollect(dev, urgency);
@@ -2395,7 +2421,10 @@ static int yaffs_BackgroundThread(void *data)
 
                 set_current_state(TASK_INTERRUPTIBLE);
 		add_timer(&timer);
-		schedule();
+		/* A writer may have kicked us since the gc pass above */
+		if(!context->bgKick)
+			schedule();
+		__set_current_state(TASK_RUNNING);
 		del_timer_sync(&timer);
 #else
 		msleep(10);
@@ -2928,7 +2957,8 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 	param->nChunksPerBlock = YAFFS_CHUNKS_PER_BLOCK;
 	param->totalBytesPerChunk = YAFFS_BYTES_PER_CHUNK;
 	param->nReservedBlocks = 5;
-	param->nShortOpCaches = (options.no_cache) ? 0 : 10;
+	param->nShortOpCaches = (options.no_cache) ? 0 : yaffs_cache_chunks;
+	param->nCacheReadAhead = yaffs_cache_readahead;
 	param->inbandTags = options.inband_tags;
 
 #ifdef CONFIG_YAFFS_DISABLE_LAZY_LOAD
@@ -3013,6 +3043,8 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 
 	param->markSuperBlockDirty = yaffs_MarkSuperBlockDirty;
 	param->gcControl = yaffs_gc_control_callback;
+	param->gcWake = yaffs_gc_wake_callback;
+	param->nBgReserveBlocks = yaffs_bg_reserve;
 
 	yaffs_DeviceToLC(dev)->superBlock= sb;
 	
@@ -3210,7 +3242,9 @@ static char *yaffs_dump_dev_part0(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "disableLazyLoad.... %d\n", dev->param.disableLazyLoad);
 	buf += sprintf(buf, "refreshPeriod...... %d\n", dev->param.refreshPeriod);
 	buf += sprintf(buf, "nShortOpCaches..... %d\n", dev->param.nShortOpCaches);
+	buf += sprintf(buf, "nCacheReadAhead.... %d\n", dev->param.nCacheReadAhead);
 	buf += sprintf(buf, "nReservedBlocks.... %d\n", dev->param.nReservedBlocks);
+	buf += sprintf(buf, "nBgReserveBlocks... %d\n", dev->param.nBgReserveBlocks);
 	buf += sprintf(buf, "alwaysCheckErased.. %d\n", dev->param.alwaysCheckErased);
 
 	buf += sprintf(buf, "\n");
@@ -3240,6 +3274,7 @@ static char *yaffs_dump_dev_part1(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "oldestDirtyGCs..... %u\n", dev->oldestDirtyGCs);
 	buf += sprintf(buf, "nGCBlocks.......... %u\n", dev->nGCBlocks);
 	buf += sprintf(buf, "backgroundGCs...... %u\n", dev->backgroundGCs);
+	buf += sprintf(buf, "backgroundGCWakes.. %u\n", dev->backgroundGCWakes);
 	buf += sprintf(buf, "nRetriedWrites..... %u\n", dev->nRetriedWrites);
 	buf += sprintf(buf, "nRetireBlocks...... %u\n", dev->nRetiredBlocks);
 	buf += sprintf(buf, "eccFixed........... %u\n", dev->eccFixed);
@@ -3247,6 +3282,7 @@ static char *yaffs_dump_dev_part1(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "tagsEccFixed....... %u\n", dev->tagsEccFixed);
 	buf += sprintf(buf, "tagsEccUnfixed..... %u\n", dev->tagsEccUnfixed);
 	buf += sprintf(buf, "cacheHits.......... %u\n", dev->cacheHits);
+	buf += sprintf(buf, "cacheReadAheads.... %u\n", dev->cacheReadAheads);
 	buf += sprintf(buf, "nDeletedFiles...... %u\n", dev->nDeletedFiles);
 	buf += sprintf(buf, "nUnlinkedFiles..... %u\n", dev->nUnlinkedFiles);
 	buf += sprintf(buf, "refreshCount....... %u\n", dev->refreshCount);
@@ -135,6 +135,29 @@ int yaffs2_BlockNotDisqualifiedFromGC(yaffs_Device *dev,
 	return (bi->sequenceNumber <= dev->oldestDirtySequence);
 }
 
+/*
+ * yaffs2_GCBlockScore()
+ * Cost-benefit score used by the background gc to pick a victim.
+ * The benefit is the space reclaimed weighted by the age of the block
+ * (blocks written long ago hold cold data and are cheap to consolidate),
+ * the cost is reading and rewriting the chunks still in use.
+ * Higher is better.
+ */
+unsigned yaffs2_GCBlockScore(yaffs_Device *dev, yaffs_BlockInfo *bi)
+{
+	int pagesUsed = bi->pagesInUse - bi->softDeletions;
+	unsigned freeChunks = dev->param.nChunksPerBlock - pagesUsed;
+	unsigned age = 1;
+
+	if (bi->sequenceNumber <= dev->sequenceNumber)
+		age += dev->sequenceNumber - bi->sequenceNumber;
+
+	if (age > YAFFS_GC_MAX_AGE)
+		age = YAFFS_GC_MAX_AGE;
+
+	return (freeChunks * age) / (2 * pagesUsed + 1);
+}
+
 /*
  * yaffs2_FindRefreshBlock()
  * periodically finds the oldest full block by sequence number for refreshing.
@@ -21,6 +21,7 @@ void yaffs2_FindOldestDirtySequence(yaffs_Device *dev);
 void yaffs2_ClearOldestDirtySequence(yaffs_Device *dev, yaffs_BlockInfo *bi);
 void yaffs2_UpdateOldestDirtySequence(yaffs_Device *dev, unsigned blockNo, yaffs_BlockInfo *bi);
 int yaffs2_BlockNotDisqualifiedFromGC(yaffs_Device *dev, yaffs_BlockInfo *bi);
+unsigned yaffs2_GCBlockScore(yaffs_Device *dev, yaffs_BlockInfo *bi);
 __u32 yaffs2_FindRefreshBlock(yaffs_Device *dev);
 int yaffs2_CheckpointRequired(yaffs_Device *dev);
 int yaffs2_CalcCheckpointBlocksRequired(yaffs_Device *dev);
@@ -64,4 +64,7 @@
 #define SO_DOMAIN		39
 
 #define SO_RXQ_OVFL             40
+
+/* Private option, kept well away from the numbers upstream hands out */
+#define SO_RCVDEFER             0x5244
 #endif /* __ASM_GENERIC_SOCKET_H */
@@ -43,6 +43,7 @@
 #define _LINUX_FUSE_H
 
 #include <linux/types.h>
+#include <linux/ioctl.h>
 
 /*
  * Version negotiation:
@@ -568,4 +569,16 @@ struct fuse_notify_inval_entry_out {
 	__u32	padding;
 };
 
+/*
+ * Ioctls on /dev/fuse
+ *
+ * FUSE_DEV_IOC_BATCH_READ: if the argument is non-zero, a read() may
+ * return several requests back to back, as many as are queued and fit
+ * in the buffer.  Each starts with its own fuse_in_header, whose len
+ * gives the offset of the next one.  A read() still waits for the first
+ * request only.
+ */
+#define FUSE_DEV_IOC_MAGIC		229
+#define FUSE_DEV_IOC_BATCH_READ		_IOW(FUSE_DEV_IOC_MAGIC, 0x80, __u32)
+
 #endif /* _LINUX_FUSE_H */
@@ -76,6 +76,10 @@ enum ip_conntrack_status {
 	/* Conntrack is a template */
 	IPS_TEMPLATE_BIT = 11,
 	IPS_TEMPLATE = (1 << IPS_TEMPLATE_BIT),
+
+	/* FLOWOFFLOAD target asked for the flow to be offloaded */
+	IPS_OFFLOAD_BIT = 12,
+	IPS_OFFLOAD = (1 << IPS_OFFLOAD_BIT),
 };
 
 /* Connection tracking event types */
@@ -206,6 +206,7 @@ struct tcp_cookie_transactions {
 
 #include <linux/skbuff.h>
 #include <linux/dmaengine.h>
+#include <linux/hrtimer.h>
 #include <net/sock.h>
 #include <net/inet_connection_sock.h>
 #include <net/inet_timewait_sock.h>
@@ -459,6 +460,17 @@ struct tcp_sock {
 	 * contains related tcp_cookie_transactions fields.
 	 */
 	struct tcp_cookie_values  *cookie_values;
+
+/* TCP Small Queues and pacing */
+	unsigned long		tsq_flags;
+	struct list_head	tsq_node;	/* anchor in tsq_tasklet.head list */
+	struct hrtimer		tsq_timer;	/* pacing release / TSQ retry */
+	ktime_t			pacing_next;	/* earliest departure of next segment */
+};
+
+enum tsq_flags {
+	TSQ_THROTTLED,		/* stopped by tcp_limit_output_bytes */
+	TSQ_QUEUED,		/* on the per-cpu tsq_tasklet list */
 };
 
 static inline struct tcp_sock *tcp_sk(const struct sock *sk)
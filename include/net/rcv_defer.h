@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2010 Google, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _NET_RCV_DEFER_H
+#define _NET_RCV_DEFER_H
+
+#include <net/sock.h>
+
+/*
+ * Upper bound accepted for SO_RCVDEFER, in milliseconds. Batches are
+ * delivered on the next round_jiffies_up() second at the latest, so a
+ * longer delay would never take effect.
+ */
+#define RCV_DEFER_MAX_MS	1000
+
+extern void sock_wake_readable(struct sock *sk);
+
+#ifdef CONFIG_NET_RCV_DEFER
+extern bool sock_rcvdefer(struct sock *sk);
+
+static inline void sock_rcvdefer_init(struct sock *sk)
+{
+	INIT_LIST_HEAD(&sk->sk_rcvdefer_node);
+}
+#else
+static inline bool sock_rcvdefer(struct sock *sk)
+{
+	return false;
+}
+
+static inline void sock_rcvdefer_init(struct sock *sk)
+{
+}
+#endif
+
+#endif /* _NET_RCV_DEFER_H */
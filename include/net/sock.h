@@ -211,6 +211,8 @@ struct sock_common {
   *	@sk_send_head: front of stuff to transmit
   *	@sk_security: used by security modules
   *	@sk_mark: generic packet mark
+  *	@sk_rcvdefer: %SO_RCVDEFER setting, max receive wakeup delay in ms
+  *	@sk_rcvdefer_node: entry on the list of parked receive wakeups
   *	@sk_write_pending: a write to stream socket waits to start
   *	@sk_state_change: callback to indicate change in the state of the sock
   *	@sk_data_ready: callback to indicate there is data to be processed
@@ -313,6 +315,10 @@ struct sock {
 #endif
 	__u32			sk_mark;
 	u32			sk_classid;
+#ifdef CONFIG_NET_RCV_DEFER
+	unsigned int		sk_rcvdefer;
+	struct list_head	sk_rcvdefer_node;
+#endif
 	void			(*sk_state_change)(struct sock *sk);
 	void			(*sk_data_ready)(struct sock *sk, int bytes);
 	void			(*sk_write_space)(struct sock *sk);
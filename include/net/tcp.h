@@ -246,6 +246,8 @@ extern int sysctl_tcp_max_ssthresh;
 extern int sysctl_tcp_cookie_size;
 extern int sysctl_tcp_thin_linear_timeouts;
 extern int sysctl_tcp_thin_dupack;
+extern int sysctl_tcp_limit_output_bytes;
+extern int sysctl_tcp_pacing;
 
 extern atomic_t tcp_memory_allocated;
 extern struct percpu_counter tcp_sockets_allocated;
@@ -510,9 +512,14 @@ extern void tcp_cwnd_application_limited(struct sock *sk);
 extern void tcp_init_xmit_timers(struct sock *);
 static inline void tcp_clear_xmit_timers(struct sock *sk)
 {
+	hrtimer_cancel(&tcp_sk(sk)->tsq_timer);
 	inet_csk_clear_xmit_timers(sk);
 }
 
+/* tcp_output.c */
+extern void tcp_tsq_init_sock(struct sock *sk);
+extern void __init tcp_tasklet_init(void);
+
 extern unsigned int tcp_sync_mss(struct sock *sk, u32 pmtu);
 extern unsigned int tcp_current_mss(struct sock *sk);
 
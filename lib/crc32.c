@@ -26,6 +26,10 @@
 #include <linux/compiler.h>
 #include <linux/types.h>
 #include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/random.h>
 #include <asm/atomic.h>
 #include "crc32defs.h"
 #if CRC_LE_BITS == 8
@@ -47,24 +51,48 @@ MODULE_LICENSE("GPL");
 
 #if CRC_LE_BITS == 8 || CRC_BE_BITS == 8
 
-static inline u32
-crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
-{
 # ifdef __LITTLE_ENDIAN
-#  define DO_CRC(x) crc = tab[0][(crc ^ (x)) & 255] ^ (crc >> 8)
-#  define DO_CRC4 crc = tab[3][(crc) & 255] ^ \
-		tab[2][(crc >> 8) & 255] ^ \
-		tab[1][(crc >> 16) & 255] ^ \
-		tab[0][(crc >> 24) & 255]
+#  define DO_CRC(x) crc = t0[(crc ^ (x)) & 255] ^ (crc >> 8)
+#  define DO_CRC4 (t3[(q) & 255] ^ t2[(q >> 8) & 255] ^ \
+		   t1[(q >> 16) & 255] ^ t0[(q >> 24) & 255])
+#  define DO_CRC8 (t7[(q) & 255] ^ t6[(q >> 8) & 255] ^ \
+		   t5[(q >> 16) & 255] ^ t4[(q >> 24) & 255])
 # else
-#  define DO_CRC(x) crc = tab[0][((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
-#  define DO_CRC4 crc = tab[0][(crc) & 255] ^ \
-		tab[1][(crc >> 8) & 255] ^ \
-		tab[2][(crc >> 16) & 255] ^ \
-		tab[3][(crc >> 24) & 255]
+#  define DO_CRC(x) crc = t0[((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
+#  define DO_CRC4 (t0[(q) & 255] ^ t1[(q >> 8) & 255] ^ \
+		   t2[(q >> 16) & 255] ^ t3[(q >> 24) & 255])
+#  define DO_CRC8 (t4[(q) & 255] ^ t5[(q >> 8) & 255] ^ \
+		   t6[(q >> 16) & 255] ^ t7[(q >> 24) & 255])
 # endif
+
+/*
+ * The table-driven loops below all work on a crc held in the byte order
+ * of the tables, and differ only in how many bytes they consume per
+ * iteration.  Which one is fastest depends on the cache and load
+ * pipeline of the CPU, so crc32_init() times them and picks one.
+ */
+typedef u32 (*crc32_body_fn)(u32 crc, unsigned char const *buf, size_t len,
+			     const u32 (*tab)[256]);
+
+/* one byte per iteration, uses 1KB of table */
+static u32 crc32_body_1(u32 crc, unsigned char const *buf, size_t len,
+			const u32 (*tab)[256])
+{
+	const u32 *t0 = tab[0];
+
+	while (len--)
+		DO_CRC(*buf++);
+	return crc;
+}
+
+/* slice-by-4: four bytes per iteration, uses 4KB of table */
+static u32 crc32_body_4(u32 crc, unsigned char const *buf, size_t len,
+			const u32 (*tab)[256])
+{
+	const u32 *t0 = tab[0], *t1 = tab[1], *t2 = tab[2], *t3 = tab[3];
 	const u32 *b;
 	size_t    rem_len;
+	u32       q;
 
 	/* Align it */
 	if (unlikely((long)buf & 3 && len)) {
@@ -77,8 +105,8 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 	len = len >> 2;
 	b = (const u32 *)buf;
 	for (--b; len; --len) {
-		crc ^= *++b; /* use pre increment for speed */
-		DO_CRC4;
+		q = crc ^ *++b; /* use pre increment for speed */
+		crc = DO_CRC4;
 	}
 	len = rem_len;
 	/* And the last few bytes */
@@ -89,9 +117,58 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 		} while (--len);
 	}
 	return crc;
+}
+
+/* slice-by-8: eight bytes per iteration, uses 8KB of table */
+static u32 crc32_body_8(u32 crc, unsigned char const *buf, size_t len,
+			const u32 (*tab)[256])
+{
+	const u32 *t0 = tab[0], *t1 = tab[1], *t2 = tab[2], *t3 = tab[3];
+	const u32 *t4 = tab[4], *t5 = tab[5], *t6 = tab[6], *t7 = tab[7];
+	const u32 *b;
+	size_t    rem_len;
+	u32       q;
+
+	/* Align it */
+	if (unlikely((long)buf & 3 && len)) {
+		do {
+			DO_CRC(*buf++);
+		} while ((--len) && ((long)buf)&3);
+	}
+	rem_len = len & 7;
+	/* load data 32 bits wide, two words per iteration. */
+	len = len >> 3;
+	b = (const u32 *)buf;
+	for (--b; len; --len) {
+		q = crc ^ *++b; /* use pre increment for speed */
+		crc = DO_CRC8;
+		q = *++b;
+		crc ^= DO_CRC4;
+	}
+	len = rem_len;
+	/* And the last few bytes */
+	if (len) {
+		u8 *p = (u8 *)(b + 1) - 1;
+		do {
+			DO_CRC(*++p); /* use pre increment for speed */
+		} while (--len);
+	}
+	return crc;
+}
 #undef DO_CRC
 #undef DO_CRC4
-}
+#undef DO_CRC8
+
+static const struct {
+	const char	*name;
+	crc32_body_fn	body;
+} crc32_bodies[] = {
+	{ "slice-by-8",	crc32_body_8 },
+	{ "slice-by-4",	crc32_body_4 },
+	{ "byte",	crc32_body_1 },
+};
+
+static crc32_body_fn crc32_body __read_mostly = crc32_body_8;
 #endif
 /**
  * crc32_le() - Calculate bitwise little-endian Ethernet AUTODIN II CRC32
@@ -102,46 +179,92 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
  */
 u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len);
 
+/**
+ * __crc32c_le() - Calculate little-endian CRC32c (Castagnoli)
+ * @crc: seed value for computation, or the previous crc32c value if
+ *	computing incrementally.
+ * @p: pointer to buffer over which CRC is run
+ * @len: length of buffer @p
+ *
+ * Like crc32_le() the seed is used as is and the result is not inverted;
+ * the crc32c users in crypto/ and libcrc32c take care of that.
+ */
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len);
+
 #if CRC_LE_BITS == 1
 /*
  * In fact, the table-based code will work in this case, but it can be
  * simplified by inlining the table in ?: form.
  */
 
-u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+static inline u32 crc32_le_generic(u32 crc, unsigned char const *p,
+				   size_t len, u32 polynomial)
 {
 	int i;
 	while (len--) {
 		crc ^= *p++;
 		for (i = 0; i < 8; i++)
-			crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_LE : 0);
+			crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
 	}
 	return crc;
 }
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, CRCPOLY_LE);
+}
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, CRC32C_POLY_LE);
+}
 #else				/* Table-based approach */
 
 u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
 {
 # if CRC_LE_BITS == 8
-	const u32      (*tab)[] = crc32table_le;
+	crc = __cpu_to_le32(crc);
+	crc = crc32_body(crc, p, len, crc32table_le);
+	return __le32_to_cpu(crc);
+# elif CRC_LE_BITS == 4
+	while (len--) {
+		crc ^= *p++;
+		crc = (crc >> 4) ^ crc32table_le[0][crc & 15];
+		crc = (crc >> 4) ^ crc32table_le[0][crc & 15];
+	}
+	return crc;
+# elif CRC_LE_BITS == 2
+	while (len--) {
+		crc ^= *p++;
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
+	}
+	return crc;
+# endif
+}
 
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+# if CRC_LE_BITS == 8
 	crc = __cpu_to_le32(crc);
-	crc = crc32_body(crc, p, len, tab);
+	crc = crc32_body(crc, p, len, crc32ctable_le);
 	return __le32_to_cpu(crc);
 # elif CRC_LE_BITS == 4
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
+		crc = (crc >> 4) ^ crc32ctable_le[0][crc & 15];
+		crc = (crc >> 4) ^ crc32ctable_le[0][crc & 15];
 	}
 	return crc;
 # elif CRC_LE_BITS == 2
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
+		crc = (crc >> 2) ^ crc32ctable_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32ctable_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32ctable_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32ctable_le[0][crc & 3];
 	}
 	return crc;
 # endif
@@ -180,25 +303,23 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 {
 # if CRC_BE_BITS == 8
-	const u32      (*tab)[] = crc32table_be;
-
 	crc = __cpu_to_be32(crc);
-	crc = crc32_body(crc, p, len, tab);
+	crc = crc32_body(crc, p, len, crc32table_be);
 	return __be32_to_cpu(crc);
 # elif CRC_BE_BITS == 4
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
 	}
 	return crc;
 # elif CRC_BE_BITS == 2
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
 	}
 	return crc;
 # endif
@@ -207,6 +328,157 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 
 EXPORT_SYMBOL(crc32_le);
 EXPORT_SYMBOL(crc32_be);
+EXPORT_SYMBOL(__crc32c_le);
+
+#if CRC_LE_BITS == 8 || CRC_BE_BITS == 8
+
+#define CRC32_BENCH_LEN		4096
+#define CRC32_BENCH_LOOPS	32
+
+#ifdef CONFIG_CRC32_SELFTEST
+/* bitwise reference implementations, straight from the tutorial below */
+static u32 __init crc32_le_bitwise(u32 crc, unsigned char const *p,
+				   size_t len, u32 polynomial)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+	}
+	return crc;
+}
+
+static u32 __init crc32_be_bitwise(u32 crc, unsigned char const *p,
+				   size_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++ << 24;
+		for (i = 0; i < 8; i++)
+			crc = (crc << 1) ^
+			      ((crc & 0x80000000) ? CRCPOLY_BE : 0);
+	}
+	return crc;
+}
+
+/*
+ * Check every table-driven loop against the bitwise reference for all
+ * three polynomials, over a range of lengths, alignments and seeds.
+ */
+static int __init crc32_selftest(unsigned char *buf)
+{
+	unsigned int i, off, len, errors = 0;
+	u32 seed, ref, crc;
+
+	get_random_bytes(buf, CRC32_BENCH_LEN);
+
+	for (i = 0; i < ARRAY_SIZE(crc32_bodies); i++) {
+		crc32_body_fn body = crc32_bodies[i].body;
+
+		for (len = 0; len < 512; len = len < 32 ? len + 1 : len + 37) {
+			for (off = 0; off < 8; off++) {
+				seed = len & 1 ? ~0 : buf[len] * 0x01010101;
+#if CRC_LE_BITS == 8
+				ref = crc32_le_bitwise(seed, buf + off, len,
+						       CRCPOLY_LE);
+				crc = __le32_to_cpu(body(__cpu_to_le32(seed),
+						buf + off, len, crc32table_le));
+				if (crc != ref)
+					errors++;
+
+				ref = crc32_le_bitwise(seed, buf + off, len,
+						       CRC32C_POLY_LE);
+				crc = __le32_to_cpu(body(__cpu_to_le32(seed),
+						buf + off, len, crc32ctable_le));
+				if (crc != ref)
+					errors++;
+#endif
+#if CRC_BE_BITS == 8
+				ref = crc32_be_bitwise(seed, buf + off, len);
+				crc = __be32_to_cpu(body(__cpu_to_be32(seed),
+						buf + off, len, crc32table_be));
+				if (crc != ref)
+					errors++;
+#endif
+			}
+		}
+
+		if (errors) {
+			printk(KERN_ERR "crc32: %s self-test failed, "
+			       "%u errors\n", crc32_bodies[i].name, errors);
+			return -EINVAL;
+		}
+	}
+
+	printk(KERN_INFO "crc32: self-test passed\n");
+	return 0;
+}
+#else
+static inline int crc32_selftest(unsigned char *buf)
+{
+	return 0;
+}
+#endif /* CONFIG_CRC32_SELFTEST */
+
+/* the loops are timed on whichever table is sliced */
+#if CRC_LE_BITS == 8
+# define crc32_bench_table	crc32table_le
+#else
+# define crc32_bench_table	crc32table_be
+#endif
+
+/*
+ * Time each table-driven loop over a 4KB buffer and use the fastest one
+ * for crc32_le(), crc32_be() and __crc32c_le().  Callers before this
+ * runs simply use the slice-by-8 default.
+ */
+static int __init crc32_init(void)
+{
+	unsigned char *buf;
+	unsigned int i, j, best = 0;
+	s64 ns, best_ns = 0;
+	ktime_t start;
+	u32 crc = 0;
+
+	buf = kmalloc(CRC32_BENCH_LEN, GFP_KERNEL);
+	if (!buf)
+		return 0;
+
+	if (crc32_selftest(buf)) {
+		kfree(buf);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(crc32_bodies); i++) {
+		crc32_body_fn body = crc32_bodies[i].body;
+
+		/* warm the tables up first */
+		crc = body(crc, buf, CRC32_BENCH_LEN, crc32_bench_table);
+
+		start = ktime_get();
+		for (j = 0; j < CRC32_BENCH_LOOPS; j++)
+			crc = body(crc, buf, CRC32_BENCH_LEN, crc32_bench_table);
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		if (i == 0 || ns < best_ns) {
+			best = i;
+			best_ns = ns;
+		}
+	}
+
+	crc32_body = crc32_bodies[best].body;
+	printk(KERN_INFO "crc32: using %s (%lld ns per %u bytes)\n",
+	       crc32_bodies[best].name, div_s64(best_ns, CRC32_BENCH_LOOPS),
+	       CRC32_BENCH_LEN);
+
+	kfree(buf);
+	return 0;
+}
+module_init(crc32_init);
+#endif
 
 /*
  * A brief CRC tutorial.
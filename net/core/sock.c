@@ -125,6 +125,7 @@
 #include <net/xfrm.h>
 #include <linux/ipsec.h>
 #include <net/cls_cgroup.h>
+#include <net/rcv_defer.h>
 
 #include <linux/filter.h>
 
@@ -740,6 +741,14 @@ set_rcvbuf:
 		else
 			sock_reset_flag(sk, SOCK_RXQ_OVFL);
 		break;
+#ifdef CONFIG_NET_RCV_DEFER
+	case SO_RCVDEFER:
+		if (val < 0)
+			ret = -EINVAL;
+		else
+			sk->sk_rcvdefer = min_t(unsigned int, val, RCV_DEFER_MAX_MS);
+		break;
+#endif
 	default:
 		ret = -ENOPROTOOPT;
 		break;
@@ -957,6 +966,12 @@ int sock_getsockopt(struct socket *sock, int level, int optname,
 		v.val = !!sock_flag(sk, SOCK_RXQ_OVFL);
 		break;
 
+#ifdef CONFIG_NET_RCV_DEFER
+	case SO_RCVDEFER:
+		v.val = sk->sk_rcvdefer;
+		break;
+#endif
+
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -1202,6 +1217,7 @@ struct sock *sk_clone(const struct sock *sk, const gfp_t priority)
 
 		spin_lock_init(&newsk->sk_dst_lock);
 		rwlock_init(&newsk->sk_callback_lock);
+		sock_rcvdefer_init(newsk);
 		lockdep_set_class_and_name(&newsk->sk_callback_lock,
 				af_callback_keys + newsk->sk_family,
 				af_family_clock_key_strings[newsk->sk_family]);
@@ -1862,7 +1878,7 @@ static void sock_def_error_report(struct sock *sk)
 	rcu_read_unlock();
 }
 
-static void sock_def_readable(struct sock *sk, int len)
+void sock_wake_readable(struct sock *sk)
 {
 	struct socket_wq *wq;
 
@@ -1875,6 +1891,14 @@ static void sock_def_readable(struct sock *sk, int len)
 	rcu_read_unlock();
 }
 
+static void sock_def_readable(struct sock *sk, int len)
+{
+	/* SO_RCVDEFER sockets get woken by the next batch instead */
+	if (sock_rcvdefer(sk))
+		return;
+	sock_wake_readable(sk);
+}
+
 static void sock_def_write_space(struct sock *sk)
 {
 	struct socket_wq *wq;
@@ -1938,6 +1962,7 @@ void sock_init_data(struct socket *sock, struct sock *sk)
 	sk->sk_send_head	=	NULL;
 
 	init_timer(&sk->sk_timer);
+	sock_rcvdefer_init(sk);
 
 	sk->sk_allocation	=	GFP_KERNEL;
 	sk->sk_rcvbuf		=	sysctl_rmem_default;
@@ -0,0 +1,678 @@
+/*
+ * IPv4 flow offload: forwarding fast path for established conntrack flows
+ *
+ * Once a forwarded TCP or UDP connection is established and a FLOWOFFLOAD
+ * rule in the filter FORWARD chain has selected it, each direction is
+ * entered into a small flow table keyed by the packet tuple as it is
+ * received.  A PRE_ROUTING hook running before conntrack looks packets up
+ * there; on a hit the NAT rewrite recorded in the conntrack tuples is
+ * applied, the TTL decremented and the packet handed straight to the
+ * cached neighbour, skipping conntrack, the nat/mangle/filter tables and
+ * the routing lookup.
+ *
+ * The conntrack entry stays authoritative: a garbage collector pushes its
+ * timeout forward while the fast path carries traffic, TCP FIN/RST/SYN
+ * segments tear the flow down and go through the regular path, and a flow
+ * whose conntrack dies or whose route goes stale is removed.
+ *
+ * Rules only see the packets that set a flow up.  Replacing the table that
+ * holds a FLOWOFFLOAD rule flushes the flow table, so every flow passes
+ * through the new ruleset again before it can return to the fast path.
+ * Flows that use IPsec are never offloaded, the fast path would bypass
+ * both the policy check and the transform.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/types.h>
+#include <linux/ip.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <linux/jhash.h>
+#include <linux/module.h>
+#include <linux/netdevice.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/random.h>
+#include <linux/skbuff.h>
+#include <linux/workqueue.h>
+#include <net/checksum.h>
+#include <net/dst.h>
+#include <net/ip.h>
+#include <net/neighbour.h>
+#include <net/net_namespace.h>
+
+#include <linux/netfilter/x_tables.h>
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_core.h>
+#include <net/netfilter/nf_conntrack_helper.h>
+
+#define FLOW_OFFLOAD_HSIZE	256
+
+static unsigned int flow_offload_max __read_mostly = 4096;
+module_param_named(max_flows, flow_offload_max, uint, 0644);
+MODULE_PARM_DESC(max_flows, "maximum number of offloaded flow directions");
+
+struct flow_offload_tuple {
+	__be32			saddr;
+	__be32			daddr;
+	__be16			sport;
+	__be16			dport;
+	u8			proto;
+	int			iif;
+};
+
+struct flow_offload {
+	struct hlist_node	node;
+	struct rcu_head		rcu;
+	struct net		*net;
+	struct flow_offload_tuple tuple;	/* as received */
+	struct flow_offload_tuple nat;		/* as sent, iif unused */
+	struct dst_entry	*dst;
+	struct nf_conn		*ct;
+	unsigned long		ct_timeout;	/* conntrack timeout to refresh with */
+	unsigned long		last_used;
+	bool			dead;
+};
+
+static struct hlist_head flow_offload_hash[FLOW_OFFLOAD_HSIZE];
+static DEFINE_SPINLOCK(flow_offload_lock);
+static unsigned int flow_offload_count;
+static u32 flow_offload_rnd __read_mostly;
+
+static struct delayed_work flow_offload_gc_work;
+static unsigned long flow_offload_gc_last;
+
+struct flow_offload_stats {
+	unsigned long	installs;
+	unsigned long	hits;
+	unsigned long	teardowns;
+};
+
+static DEFINE_PER_CPU(struct flow_offload_stats, flow_offload_stats);
+
+static inline unsigned int flow_offload_hashfn(const struct flow_offload_tuple *t)
+{
+	return jhash_3words((__force u32)t->saddr,
+			    (__force u32)t->daddr ^ t->iif,
+			    ((__force u32)t->sport << 16 | (__force u32)t->dport) ^
+			    t->proto, flow_offload_rnd) & (FLOW_OFFLOAD_HSIZE - 1);
+}
+
+static inline bool flow_offload_tuple_equal(const struct flow_offload_tuple *a,
+					    const struct flow_offload_tuple *b)
+{
+	return a->saddr == b->saddr && a->daddr == b->daddr &&
+	       a->sport == b->sport && a->dport == b->dport &&
+	       a->proto == b->proto && a->iif == b->iif;
+}
+
+static struct flow_offload *
+flow_offload_lookup(const struct net *net, const struct flow_offload_tuple *t)
+{
+	struct flow_offload *flow;
+	struct hlist_node *n;
+
+	hlist_for_each_entry_rcu(flow, n,
+				 &flow_offload_hash[flow_offload_hashfn(t)], node) {
+		if (net_eq(flow->net, net) &&
+		    flow_offload_tuple_equal(&flow->tuple, t))
+			return flow;
+	}
+	return NULL;
+}
+
+static void flow_offload_free_rcu(struct rcu_head *head)
+{
+	struct flow_offload *flow = container_of(head, struct flow_offload, rcu);
+
+	dst_release(flow->dst);
+	nf_ct_put(flow->ct);
+	kfree(flow);
+}
+
+/* Called with flow_offload_lock held */
+static void flow_offload_del(struct flow_offload *flow)
+{
+	hlist_del_rcu(&flow->node);
+	flow_offload_count--;
+	this_cpu_inc(flow_offload_stats.teardowns);
+	call_rcu(&flow->rcu, flow_offload_free_rcu);
+}
+
+static void flow_offload_teardown(struct flow_offload *flow)
+{
+	spin_lock_bh(&flow_offload_lock);
+	if (!flow->dead) {
+		flow->dead = true;
+		flow_offload_del(flow);
+	}
+	spin_unlock_bh(&flow_offload_lock);
+}
+
+static bool flow_offload_stale(const struct flow_offload *flow)
+{
+	return flow->dead || flow->dst->obsolete ||
+	       nf_ct_is_dying(flow->ct) || !timer_pending(&flow->ct->timeout);
+}
+
+/* __nf_ct_refresh_acct() without an skb to account */
+static void flow_offload_refresh_ct(struct flow_offload *flow)
+{
+	struct nf_conn *ct = flow->ct;
+	unsigned long newtime = jiffies + flow->ct_timeout;
+
+	if (test_bit(IPS_FIXED_TIMEOUT_BIT, &ct->status))
+		return;
+	if (newtime - ct->timeout.expires >= HZ)
+		mod_timer_pending(&ct->timeout, newtime);
+}
+
+static void flow_offload_add(struct net *net, struct nf_conn *ct,
+			     enum ip_conntrack_dir dir, int iif,
+			     struct dst_entry *dst)
+{
+	const struct nf_conntrack_tuple *orig = &ct->tuplehash[dir].tuple;
+	const struct nf_conntrack_tuple *reply = &ct->tuplehash[!dir].tuple;
+	struct flow_offload_tuple tuple;
+	struct flow_offload *flow;
+	long timeout;
+
+	tuple.saddr = orig->src.u3.ip;
+	tuple.daddr = orig->dst.u3.ip;
+	tuple.sport = orig->src.u.all;
+	tuple.dport = orig->dst.u.all;
+	tuple.proto = orig->dst.protonum;
+	tuple.iif = iif;
+
+	/*
+	 * Packets keep coming through here until the flow is in the table
+	 * and whenever the fast path turns one down, don't allocate and take
+	 * the lock for those.  Rechecked under the lock below.
+	 */
+	if (flow_offload_count >= flow_offload_max ||
+	    flow_offload_lookup(net, &tuple))
+		return;
+
+	flow = kzalloc(sizeof(*flow), GFP_ATOMIC);
+	if (!flow)
+		return;
+
+	flow->net = net;
+	flow->tuple = tuple;
+
+	/* The packet leaves looking like the inverse of the reply tuple */
+	flow->nat.saddr = reply->dst.u3.ip;
+	flow->nat.daddr = reply->src.u3.ip;
+	flow->nat.sport = reply->dst.u.all;
+	flow->nat.dport = reply->src.u.all;
+	flow->nat.proto = orig->dst.protonum;
+
+	/* This packet has just refreshed the conntrack timer */
+	timeout = (long)(ct->timeout.expires - jiffies);
+	flow->ct_timeout = max_t(long, timeout, HZ);
+	flow->last_used = jiffies;
+
+	spin_lock_bh(&flow_offload_lock);
+	if (flow_offload_count >= flow_offload_max ||
+	    flow_offload_lookup(net, &flow->tuple)) {
+		spin_unlock_bh(&flow_offload_lock);
+		kfree(flow);
+		return;
+	}
+
+	dst_hold(dst);
+	flow->dst = dst;
+	nf_conntrack_get(&ct->ct_general);
+	flow->ct = ct;
+
+	if (nf_ct_protonum(ct) == IPPROTO_TCP) {
+		/*
+		 * conntrack stops seeing the sequence space while the flow is
+		 * offloaded, don't let the closing segments fail its window check
+		 */
+		spin_lock(&ct->lock);
+		ct->proto.tcp.seen[0].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		ct->proto.tcp.seen[1].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		spin_unlock(&ct->lock);
+	}
+
+	hlist_add_head_rcu(&flow->node,
+			   &flow_offload_hash[flow_offload_hashfn(&flow->tuple)]);
+	flow_offload_count++;
+	this_cpu_inc(flow_offload_stats.installs);
+
+	/* The gc stops while the table is empty, restart it */
+	if (flow_offload_count == 1)
+		schedule_delayed_work(&flow_offload_gc_work, HZ);
+	spin_unlock_bh(&flow_offload_lock);
+}
+
+static void flow_offload_nat(struct sk_buff *skb, unsigned int thoff,
+			     const struct flow_offload *flow)
+{
+	struct iphdr *iph = ip_hdr(skb);
+	__be16 *ports = (__be16 *)(skb_network_header(skb) + thoff);
+	__sum16 *check = NULL;
+	bool udp = false;
+
+	if (iph->protocol == IPPROTO_TCP) {
+		check = &((struct tcphdr *)ports)->check;
+	} else {
+		struct udphdr *uh = (struct udphdr *)ports;
+
+		udp = true;
+		if (uh->check || skb->ip_summed == CHECKSUM_PARTIAL)
+			check = &uh->check;
+	}
+
+	if (iph->saddr != flow->nat.saddr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->saddr,
+						 flow->nat.saddr, 1);
+		csum_replace4(&iph->check, iph->saddr, flow->nat.saddr);
+		iph->saddr = flow->nat.saddr;
+	}
+	if (iph->daddr != flow->nat.daddr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->daddr,
+						 flow->nat.daddr, 1);
+		csum_replace4(&iph->check, iph->daddr, flow->nat.daddr);
+		iph->daddr = flow->nat.daddr;
+	}
+	if (ports[0] != flow->nat.sport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[0],
+						 flow->nat.sport, 0);
+		ports[0] = flow->nat.sport;
+	}
+	if (ports[1] != flow->nat.dport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[1],
+						 flow->nat.dport, 0);
+		ports[1] = flow->nat.dport;
+	}
+	if (udp && check && !*check)
+		*check = CSUM_MANGLED_0;
+}
+
+/* skb_gso_network_seglen() for the fast path, only TCP GSO is handled */
+static bool flow_offload_mtu_ok(const struct sk_buff *skb, unsigned int thoff,
+				unsigned int mtu)
+{
+	const struct tcphdr *th;
+
+	if (!skb_is_gso(skb))
+		return skb->len <= mtu;
+	if (!(skb_shinfo(skb)->gso_type & SKB_GSO_TCPV4))
+		return false;
+
+	th = (const struct tcphdr *)(skb_network_header(skb) + thoff);
+	return thoff + th->doff * 4 + skb_shinfo(skb)->gso_size <= mtu;
+}
+
+static unsigned int flow_offload_in(unsigned int hooknum,
+				    struct sk_buff *skb,
+				    const struct net_device *in,
+				    const struct net_device *out,
+				    int (*okfn)(struct sk_buff *))
+{
+	struct flow_offload_tuple tuple;
+	struct flow_offload *flow;
+	struct dst_entry *dst;
+	const struct iphdr *iph;
+	unsigned int thoff, hdrlen;
+	__be16 *ports;
+
+	if (!flow_offload_count)
+		return NF_ACCEPT;
+
+	/* Decapsulated IPsec traffic has to meet the forward policy check */
+	if (skb_sec_path(skb))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || iph->ttl <= 1 ||
+	    (iph->frag_off & htons(IP_MF | IP_OFFSET)))
+		return NF_ACCEPT;
+
+	switch (iph->protocol) {
+	case IPPROTO_TCP:
+		hdrlen = sizeof(struct tcphdr);
+		break;
+	case IPPROTO_UDP:
+		hdrlen = sizeof(struct udphdr);
+		break;
+	default:
+		return NF_ACCEPT;
+	}
+
+	thoff = iph->ihl * 4;
+	if (!pskb_may_pull(skb, thoff + hdrlen))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	ports = (__be16 *)(skb_network_header(skb) + thoff);
+	tuple.saddr = iph->saddr;
+	tuple.daddr = iph->daddr;
+	tuple.sport = ports[0];
+	tuple.dport = ports[1];
+	tuple.proto = iph->protocol;
+	tuple.iif = in->ifindex;
+
+	flow = flow_offload_lookup(dev_net(in), &tuple);
+	if (!flow)
+		return NF_ACCEPT;
+
+	if (flow_offload_stale(flow)) {
+		flow_offload_teardown(flow);
+		return NF_ACCEPT;
+	}
+
+	if (iph->protocol == IPPROTO_TCP) {
+		const struct tcphdr *th = (const struct tcphdr *)ports;
+
+		/* Let conntrack see the connection close */
+		if (th->fin || th->rst || th->syn) {
+			flow_offload_teardown(flow);
+			return NF_ACCEPT;
+		}
+	}
+
+	dst = flow->dst;
+	if (!flow_offload_mtu_ok(skb, thoff, dst_mtu(dst)) ||
+	    (!dst->hh && !dst->neighbour))
+		return NF_ACCEPT;
+
+	if (skb_cow(skb, LL_RESERVED_SPACE(dst->dev)))
+		return NF_ACCEPT;
+
+	flow_offload_nat(skb, thoff, flow);
+	ip_decrease_ttl(ip_hdr(skb));
+	flow->last_used = jiffies;
+	this_cpu_inc(flow_offload_stats.hits);
+
+	skb_dst_drop(skb);
+	skb_dst_set(skb, dst_clone(dst));
+	skb->dev = dst->dev;
+	skb->protocol = htons(ETH_P_IP);
+
+	if (dst->hh)
+		neigh_hh_output(dst->hh, skb);
+	else
+		dst->neighbour->output(skb);
+
+	return NF_STOLEN;
+}
+
+static unsigned int flow_offload_out(unsigned int hooknum,
+				     struct sk_buff *skb,
+				     const struct net_device *in,
+				     const struct net_device *out,
+				     int (*okfn)(struct sk_buff *))
+{
+	enum ip_conntrack_info ctinfo;
+	struct nf_conn_help *help;
+	struct dst_entry *dst;
+	struct nf_conn *ct;
+
+	/* Only forwarded traffic */
+	if (!skb->skb_iif)
+		return NF_ACCEPT;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (!ct || nf_ct_is_untracked(skb))
+		return NF_ACCEPT;
+
+	/*
+	 * Only when this packet went through a FLOWOFFLOAD rule.  The bit is
+	 * consumed here so a flow flushed by a ruleset change has to be
+	 * selected by the new rules before it is offloaded again.
+	 */
+	if (!test_and_clear_bit(IPS_OFFLOAD_BIT, &ct->status))
+		return NF_ACCEPT;
+
+	/* Received through an IPsec tunnel */
+	if (skb_sec_path(skb))
+		return NF_ACCEPT;
+
+	if (ctinfo != IP_CT_ESTABLISHED &&
+	    ctinfo != IP_CT_ESTABLISHED + IP_CT_IS_REPLY)
+		return NF_ACCEPT;
+	if (!test_bit(IPS_ASSURED_BIT, &ct->status))
+		return NF_ACCEPT;
+
+	/* Helpers need to see every packet */
+	help = nfct_help(ct);
+	if (help && help->helper)
+		return NF_ACCEPT;
+
+	switch (nf_ct_protonum(ct)) {
+	case IPPROTO_TCP:
+		if (ct->proto.tcp.state != TCP_CONNTRACK_ESTABLISHED)
+			return NF_ACCEPT;
+		break;
+	case IPPROTO_UDP:
+		break;
+	default:
+		return NF_ACCEPT;
+	}
+
+	dst = skb_dst(skb);
+	if (!dst || (!dst->hh && !dst->neighbour))
+		return NF_ACCEPT;
+#ifdef CONFIG_XFRM
+	/* An xfrm bundle, the neighbour would get the cleartext packet */
+	if (dst->xfrm)
+		return NF_ACCEPT;
+#endif
+
+	flow_offload_add(dev_net(out), ct, CTINFO2DIR(ctinfo),
+			 skb->skb_iif, dst);
+
+	return NF_ACCEPT;
+}
+
+static struct nf_hook_ops flow_offload_ops[] __read_mostly = {
+	{
+		/* after defrag, before conntrack and the raw table */
+		.hook		= flow_offload_in,
+		.owner		= THIS_MODULE,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_PRE_ROUTING,
+		.priority	= NF_IP_PRI_RAW - 1,
+	},
+	{
+		/* after SNAT, so the conntrack tuples hold the final mapping */
+		.hook		= flow_offload_out,
+		.owner		= THIS_MODULE,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_POST_ROUTING,
+		.priority	= NF_IP_PRI_NAT_SRC + 1,
+	},
+};
+
+/*
+ * Runs once a second while there are flows. The work is deferrable: an
+ * idle CPU is not woken for it, and without traffic there is nothing to
+ * refresh anyway.
+ */
+static void flow_offload_gc(struct work_struct *work)
+{
+	struct flow_offload *flow;
+	struct hlist_node *n, *tmp;
+	unsigned int count;
+	int i;
+
+	spin_lock_bh(&flow_offload_lock);
+	for (i = 0; i < FLOW_OFFLOAD_HSIZE; i++) {
+		hlist_for_each_entry_safe(flow, n, tmp,
+					  &flow_offload_hash[i], node) {
+			if (flow_offload_stale(flow)) {
+				flow->dead = true;
+				flow_offload_del(flow);
+			} else if (time_after(flow->last_used,
+					      flow_offload_gc_last)) {
+				/* Traffic bypassed conntrack, keep it alive */
+				flow_offload_refresh_ct(flow);
+			}
+		}
+	}
+	flow_offload_gc_last = jiffies;
+	count = flow_offload_count;
+	spin_unlock_bh(&flow_offload_lock);
+
+	/* flow_offload_add() starts us again when the first flow comes in */
+	if (count)
+		schedule_delayed_work(&flow_offload_gc_work, HZ);
+}
+
+static void flow_offload_flush(struct net_device *dev)
+{
+	struct flow_offload *flow;
+	struct hlist_node *n, *tmp;
+	int i;
+
+	spin_lock_bh(&flow_offload_lock);
+	for (i = 0; i < FLOW_OFFLOAD_HSIZE; i++) {
+		hlist_for_each_entry_safe(flow, n, tmp,
+					  &flow_offload_hash[i], node) {
+			if (!dev || flow->dst->dev == dev ||
+			    (net_eq(flow->net, dev_net(dev)) &&
+			     flow->tuple.iif == dev->ifindex)) {
+				flow->dead = true;
+				flow_offload_del(flow);
+			}
+		}
+	}
+	spin_unlock_bh(&flow_offload_lock);
+}
+
+static int flow_offload_netdev_event(struct notifier_block *this,
+				     unsigned long event, void *ptr)
+{
+	if (event == NETDEV_DOWN || event == NETDEV_UNREGISTER)
+		flow_offload_flush(ptr);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block flow_offload_netdev_notifier = {
+	.notifier_call	= flow_offload_netdev_event,
+};
+
+static unsigned int
+flowoffload_tg(struct sk_buff *skb, const struct xt_action_param *par)
+{
+	enum ip_conntrack_info ctinfo;
+	struct nf_conn *ct;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (ct && !nf_ct_is_untracked(skb))
+		set_bit(IPS_OFFLOAD_BIT, &ct->status);
+
+	return XT_CONTINUE;
+}
+
+/*
+ * Every table replace destroys the old entries, so this runs whenever the
+ * rules of the table holding a FLOWOFFLOAD rule change.  Flush the flows
+ * those rules let through.
+ */
+static void flowoffload_tg_destroy(const struct xt_tgdtor_param *par)
+{
+	flow_offload_flush(NULL);
+}
+
+static struct xt_target flowoffload_tg_reg __read_mostly = {
+	.name		= "FLOWOFFLOAD",
+	.revision	= 0,
+	.family		= NFPROTO_IPV4,
+	.table		= "filter",
+	.hooks		= 1 << NF_INET_FORWARD,
+	.target		= flowoffload_tg,
+	.destroy	= flowoffload_tg_destroy,
+	.me		= THIS_MODULE,
+};
+
+static int flow_offload_read_proc(char *page, char **start, off_t off,
+				  int count, int *eof, void *data)
+{
+	struct flow_offload_stats sum = { 0 };
+	const struct flow_offload_stats *st;
+	int cpu, len;
+
+	if (off)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		st = &per_cpu(flow_offload_stats, cpu);
+		sum.installs += st->installs;
+		sum.hits += st->hits;
+		sum.teardowns += st->teardowns;
+	}
+
+	len = snprintf(page, count, "flows %u\ninstalls %lu\nhits %lu\n"
+		       "teardowns %lu\n", flow_offload_count,
+		       sum.installs, sum.hits, sum.teardowns);
+	*eof = 1;
+
+	return min(len, count);
+}
+
+static int __init flow_offload_init(void)
+{
+	int ret;
+
+	get_random_bytes(&flow_offload_rnd, sizeof(flow_offload_rnd));
+
+	/* Started by the first flow_offload_add() */
+	flow_offload_gc_last = jiffies;
+	INIT_DELAYED_WORK_DEFERRABLE(&flow_offload_gc_work, flow_offload_gc);
+
+	ret = register_netdevice_notifier(&flow_offload_netdev_notifier);
+	if (ret < 0)
+		return ret;
+
+	ret = nf_register_hooks(flow_offload_ops, ARRAY_SIZE(flow_offload_ops));
+	if (ret < 0)
+		goto err_hooks;
+
+	ret = xt_register_target(&flowoffload_tg_reg);
+	if (ret < 0)
+		goto err_target;
+
+	create_proc_read_entry("nf_flow_offload", S_IRUGO,
+			       init_net.proc_net_stat, flow_offload_read_proc,
+			       NULL);
+
+	return 0;
+
+err_target:
+	nf_unregister_hooks(flow_offload_ops, ARRAY_SIZE(flow_offload_ops));
+err_hooks:
+	unregister_netdevice_notifier(&flow_offload_netdev_notifier);
+	return ret;
+}
+
+static void __exit flow_offload_fini(void)
+{
+	remove_proc_entry("nf_flow_offload", init_net.proc_net_stat);
+	xt_unregister_target(&flowoffload_tg_reg);
+	nf_unregister_hooks(flow_offload_ops, ARRAY_SIZE(flow_offload_ops));
+	unregister_netdevice_notifier(&flow_offload_netdev_notifier);
+	cancel_delayed_work_sync(&flow_offload_gc_work);
+	flow_offload_flush(NULL);
+	rcu_barrier();
+}
+
+module_init(flow_offload_init);
+module_exit(flow_offload_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("IPv4 conntrack flow offload fast path");
+MODULE_ALIAS("ipt_FLOWOFFLOAD");
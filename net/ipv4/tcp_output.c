@@ -38,6 +38,7 @@
 
 #include <linux/compiler.h>
 #include <linux/gfp.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 
 /* People can turn this off for buggy TCP's found in printers etc. */
@@ -63,6 +64,11 @@ int sysctl_tcp_slow_start_after_idle __read_mostly = 1;
 int sysctl_tcp_cookie_size __read_mostly = 0; /* TCP_COOKIE_MAX */
 EXPORT_SYMBOL_GPL(sysctl_tcp_cookie_size);
 
+/* Bytes a socket may have in qdisc/device queues, 0 = unlimited */
+int sysctl_tcp_limit_output_bytes __read_mostly = 65536;
+
+int sysctl_tcp_pacing __read_mostly = 0;
+
 
 /* Account for new data that has been sent to the network. */
 static void tcp_event_new_data_sent(struct sock *sk, struct sk_buff *skb)
@@ -776,6 +782,168 @@ static unsigned tcp_established_options(struct sock *sk, struct sk_buff *skb,
 	return size;
 }
 
+static int tcp_write_xmit(struct sock *sk, unsigned int mss_now, int nonagle,
+			  int push_one, gfp_t gfp);
+
+/* TCP Small Queues:
+ * A socket stopped by sysctl_tcp_limit_output_bytes, or waiting for its
+ * pacing timer, is put on a per-cpu list once it may send again, and a
+ * tasklet resumes tcp_write_xmit() for it.  Each list entry holds a
+ * sk_wmem_alloc reference, dropped with sk_free() by the tasklet.
+ */
+struct tsq_tasklet {
+	struct tasklet_struct	tasklet;
+	struct list_head	head; /* queue of tcp sockets */
+};
+static DEFINE_PER_CPU(struct tsq_tasklet, tsq_tasklet);
+
+static void tcp_tsq_queue(struct sock *sk)
+{
+	struct tsq_tasklet *tsq;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	tsq = &__get_cpu_var(tsq_tasklet);
+	list_add(&tcp_sk(sk)->tsq_node, &tsq->head);
+	tasklet_schedule(&tsq->tasklet);
+	local_irq_restore(flags);
+}
+
+static inline int tcp_tsq_can_send(const struct sock *sk)
+{
+	return (1 << sk->sk_state) &
+	       (TCPF_ESTABLISHED | TCPF_FIN_WAIT1 | TCPF_CLOSING |
+		TCPF_CLOSE_WAIT  | TCPF_LAST_ACK);
+}
+
+static void tcp_tsq_arm(struct sock *sk, ktime_t expires)
+{
+	struct hrtimer *timer = &tcp_sk(sk)->tsq_timer;
+
+	if (!hrtimer_active(timer))
+		hrtimer_start(timer, expires, HRTIMER_MODE_ABS);
+}
+
+static void tcp_tasklet_func(unsigned long data)
+{
+	struct tsq_tasklet *tsq = (struct tsq_tasklet *)data;
+	LIST_HEAD(list);
+	unsigned long flags;
+	struct list_head *q, *n;
+	struct tcp_sock *tp;
+	struct sock *sk;
+
+	local_irq_save(flags);
+	list_splice_init(&tsq->head, &list);
+	local_irq_restore(flags);
+
+	list_for_each_safe(q, n, &list) {
+		tp = list_entry(q, struct tcp_sock, tsq_node);
+		list_del(&tp->tsq_node);
+
+		sk = (struct sock *)tp;
+		bh_lock_sock(sk);
+		if (tcp_tsq_can_send(sk)) {
+			if (!sock_owned_by_user(sk))
+				tcp_write_xmit(sk, tcp_current_mss(sk),
+					       tp->nonagle, 0, GFP_ATOMIC);
+			else
+				/* The owner may not push again, retry shortly */
+				tcp_tsq_arm(sk, ktime_add_ns(ktime_get(),
+							     NSEC_PER_MSEC));
+		}
+		bh_unlock_sock(sk);
+
+		clear_bit(TSQ_QUEUED, &tp->tsq_flags);
+		sk_free(sk);
+	}
+}
+
+/* skb destructor for everything tcp_transmit_skb() sends */
+static void tcp_wfree(struct sk_buff *skb)
+{
+	struct sock *sk = skb->sk;
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	if (test_and_clear_bit(TSQ_THROTTLED, &tp->tsq_flags) &&
+	    !test_and_set_bit(TSQ_QUEUED, &tp->tsq_flags)) {
+		/* Keep one reference for the tasklet */
+		atomic_sub(skb->truesize - 1, &sk->sk_wmem_alloc);
+		tcp_tsq_queue(sk);
+	} else {
+		sock_wfree(skb);
+	}
+}
+
+static enum hrtimer_restart tcp_tsq_timer_fn(struct hrtimer *timer)
+{
+	struct tcp_sock *tp = container_of(timer, struct tcp_sock, tsq_timer);
+	struct sock *sk = (struct sock *)tp;
+
+	/* tcp_clear_xmit_timers() cancels us before the socket goes away */
+	if (!test_and_set_bit(TSQ_QUEUED, &tp->tsq_flags)) {
+		atomic_inc(&sk->sk_wmem_alloc);
+		tcp_tsq_queue(sk);
+	}
+	return HRTIMER_NORESTART;
+}
+
+void tcp_tsq_init_sock(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	tp->tsq_flags = 0;
+	INIT_LIST_HEAD(&tp->tsq_node);
+	hrtimer_init(&tp->tsq_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	tp->tsq_timer.function = tcp_tsq_timer_fn;
+	tp->pacing_next = ktime_set(0, 0);
+}
+
+void __init tcp_tasklet_init(void)
+{
+	int i;
+
+	for_each_possible_cpu(i) {
+		struct tsq_tasklet *tsq = &per_cpu(tsq_tasklet, i);
+
+		INIT_LIST_HEAD(&tsq->head);
+		tasklet_init(&tsq->tasklet, tcp_tasklet_func,
+			     (unsigned long)tsq);
+	}
+}
+
+/* Pacing: release a window over one srtt, at twice cwnd/srtt in slow
+ * start and 1.2 times cwnd/srtt in congestion avoidance.
+ */
+static void tcp_pacing_advance(struct sock *sk, unsigned int len)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	u32 ratio = tp->snd_cwnd < tp->snd_ssthresh ? 20 : 12;
+	ktime_t now = ktime_get();
+	u64 ns;
+
+	if (!tp->srtt)
+		return;
+
+	ns = (u64)len * (jiffies_to_usecs(tp->srtt) >> 3) * NSEC_PER_USEC * 10;
+	ns = div64_u64(ns, (u64)tp->snd_cwnd * tp->mss_cache * ratio);
+
+	if (ktime_to_ns(ktime_sub(tp->pacing_next, now)) < 0)
+		tp->pacing_next = now;
+	tp->pacing_next = ktime_add_ns(tp->pacing_next, ns);
+}
+
+static int tcp_pacing_defer(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	if (ktime_to_ns(ktime_sub(tp->pacing_next, ktime_get())) <= 0)
+		return 0;
+
+	tcp_tsq_arm(sk, tp->pacing_next);
+	return 1;
+}
+
 /* This routine actually transmits TCP packets queued in by
  * tcp_do_sendmsg().  This is used by both the initial
  * transmission and possible later retransmissions.
@@ -834,7 +1002,11 @@ static int tcp_transmit_skb(struct sock *sk, struct sk_buff *skb, int clone_it,
 
 	skb_push(skb, tcp_header_size);
 	skb_reset_transport_header(skb);
-	skb_set_owner_w(skb, sk);
+
+	skb_orphan(skb);
+	skb->sk = sk;
+	skb->destructor = tcp_wfree;
+	atomic_add(skb->truesize, &sk->sk_wmem_alloc);
 
 	/* Build TCP header and checksum it. */
 	th = tcp_hdr(skb);
@@ -1776,11 +1948,30 @@ static int tcp_write_xmit(struct sock *sk, unsigned int mss_now, int nonagle,
 		    unlikely(tso_fragment(sk, skb, limit, mss_now)))
 			break;
 
+		/* TSQ: sk_wmem_alloc counts skb truesize, overhead included */
+		if (sysctl_tcp_limit_output_bytes &&
+		    atomic_read(&sk->sk_wmem_alloc) >= sysctl_tcp_limit_output_bytes) {
+			set_bit(TSQ_THROTTLED, &tp->tsq_flags);
+			/* The last completion may have run before the bit
+			 * was set; only stop if one is still outstanding.
+			 */
+			smp_mb__after_clear_bit();
+			if (atomic_read(&sk->sk_wmem_alloc) >=
+			    sysctl_tcp_limit_output_bytes)
+				break;
+		}
+
+		if (sysctl_tcp_pacing && tcp_pacing_defer(sk))
+			break;
+
 		TCP_SKB_CB(skb)->when = tcp_time_stamp;
 
 		if (unlikely(tcp_transmit_skb(sk, skb, 1, gfp)))
 			break;
 
+		if (sysctl_tcp_pacing)
+			tcp_pacing_advance(sk, skb->len);
+
 		/* Advance the send_head.  This one is sent out.
 		 * This call will increment packets_out.
 		 */
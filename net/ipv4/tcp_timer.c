@@ -40,6 +40,7 @@ void tcp_init_xmit_timers(struct sock *sk)
 {
 	inet_csk_init_xmit_timers(sk, &tcp_write_timer, &tcp_delack_timer,
 				  &tcp_keepalive_timer);
+	tcp_tsq_init_sock(sk);
 }
 
 EXPORT_SYMBOL(tcp_init_xmit_timers);
@@ -0,0 +1,159 @@
+/* net/rcv_defer.c
+ *
+ * Copyright (C) 2010 Google, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/proc_fs.h>
+#include <linux/suspend.h>
+#include <linux/timer.h>
+#include <net/net_namespace.h>
+#include <net/sock.h>
+#include <net/rcv_defer.h>
+
+/*
+ * Sockets marked with SO_RCVDEFER do not wake their readers for every
+ * incoming packet.  The data is queued on the socket as usual, but the
+ * wakeup is parked on a global list and issued for all parked sockets at
+ * once when a single timer fires.  The timer is aligned to the next whole
+ * second, so it shares the wakeup with other round_jiffies() users, unless
+ * that would exceed the shortest delay requested by a parked socket.
+ */
+
+static LIST_HEAD(rcv_defer_list);
+static DEFINE_SPINLOCK(rcv_defer_lock);
+static struct timer_list rcv_defer_timer;
+
+static unsigned long rcv_defer_deferred;	/* data_ready calls parked */
+static unsigned long rcv_defer_woken;	/* socket wakeups issued by batches */
+static unsigned long rcv_defer_batches;	/* batch deliveries */
+static unsigned long rcv_defer_forced;	/* parked sockets woken early, queue filling */
+
+static unsigned long rcv_defer_expires(unsigned int msecs)
+{
+	unsigned long deadline = jiffies + msecs_to_jiffies(msecs);
+	unsigned long aligned = round_jiffies_up(jiffies + 1);
+
+	return time_before_eq(aligned, deadline) ? aligned : deadline;
+}
+
+bool sock_rcvdefer(struct sock *sk)
+{
+	unsigned int msecs = sk->sk_rcvdefer;
+	unsigned long flags, expires;
+	bool parked = false;
+
+	if (!msecs)
+		return false;
+
+	spin_lock_irqsave(&rcv_defer_lock, flags);
+	if (atomic_read(&sk->sk_rmem_alloc) > (sk->sk_rcvbuf >> 1)) {
+		/* Holding back any longer risks drops, deliver now */
+		rcv_defer_forced++;
+		if (!list_empty(&sk->sk_rcvdefer_node)) {
+			list_del_init(&sk->sk_rcvdefer_node);
+			/* the caller still holds a reference */
+			__sock_put(sk);
+		}
+		spin_unlock_irqrestore(&rcv_defer_lock, flags);
+		return false;
+	}
+
+	if (list_empty(&sk->sk_rcvdefer_node)) {
+		sock_hold(sk);
+		list_add_tail(&sk->sk_rcvdefer_node, &rcv_defer_list);
+		parked = true;
+	}
+	rcv_defer_deferred++;
+
+	if (parked) {
+		expires = rcv_defer_expires(msecs);
+		if (!timer_pending(&rcv_defer_timer) ||
+		    time_before(expires, rcv_defer_timer.expires))
+			mod_timer(&rcv_defer_timer, expires);
+	}
+	spin_unlock_irqrestore(&rcv_defer_lock, flags);
+
+	return true;
+}
+
+static void rcv_defer_flush(void)
+{
+	struct sock *sk;
+	unsigned long flags;
+
+	spin_lock_irqsave(&rcv_defer_lock, flags);
+	if (!list_empty(&rcv_defer_list))
+		rcv_defer_batches++;
+	while (!list_empty(&rcv_defer_list)) {
+		sk = list_first_entry(&rcv_defer_list, struct sock,
+				      sk_rcvdefer_node);
+		list_del_init(&sk->sk_rcvdefer_node);
+		rcv_defer_woken++;
+		spin_unlock_irqrestore(&rcv_defer_lock, flags);
+
+		sock_wake_readable(sk);
+		sock_put(sk);
+
+		spin_lock_irqsave(&rcv_defer_lock, flags);
+	}
+	spin_unlock_irqrestore(&rcv_defer_lock, flags);
+}
+
+static void rcv_defer_timer_fn(unsigned long data)
+{
+	rcv_defer_flush();
+}
+
+static int rcv_defer_read_proc(char *page, char **start, off_t off,
+			       int count, int *eof, void *data)
+{
+	int len;
+
+	if (off)
+		return 0;
+
+	len = snprintf(page, count,
+		       "deferred %lu\nwoken %lu\nbatches %lu\nforced %lu\n"
+		       "wakeups_avoided %lu\n",
+		       rcv_defer_deferred, rcv_defer_woken, rcv_defer_batches,
+		       rcv_defer_forced, rcv_defer_deferred - rcv_defer_woken);
+	*eof = 1;
+
+	return min(len, count);
+}
+
+static int rcv_defer_notifier(struct notifier_block *nb,
+			      unsigned long event, void *dummy)
+{
+	/*
+	 * The timer does not run while suspended, so a deferred wakeup
+	 * would wait out the whole suspend instead of RCV_DEFER_MAX_MS.
+	 */
+	if (event == PM_SUSPEND_PREPARE)
+		rcv_defer_flush();
+
+	return 0;
+}
+
+static struct notifier_block rcv_defer_notifier_block = {
+	.notifier_call = rcv_defer_notifier,
+};
+
+static int __init rcv_defer_init(void)
+{
+	setup_timer(&rcv_defer_timer, rcv_defer_timer_fn, 0);
+	create_proc_read_entry("rcv_defer", S_IRUGO,
+			init_net.proc_net_stat, rcv_defer_read_proc, NULL);
+	return register_pm_notifier(&rcv_defer_notifier_block);
+}
+
+subsys_initcall(rcv_defer_init);